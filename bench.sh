@@ -0,0 +1,9 @@
+#!/bin/bash
+
+# Build the Google Benchmark suite (requires libbenchmark, e.g. the 'libbenchmark-dev' package)
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -Isrc bench/TextFormatterBench.cpp -lbenchmark -o textformatter_bench || exit 1
+
+# Run it; extra arguments are passed straight to Google Benchmark, for example:
+#   ./bench.sh --benchmark_filter='Upper/in_place/ascii'
+#   ./bench.sh --benchmark_format=json --benchmark_out=bench_output.txt
+./textformatter_bench "$@"
@@ -0,0 +1,551 @@
+/*
+File:           TextFormatterBench.cpp
+Description:    Google Benchmark suite for the formatting strategies and the TextProcessor dispatch path.
+                - Strategy throughput: every built-in strategy, input sizes from 16 B to 1 GB, and four
+                  character mixes (pure ASCII, mixed case, UTF-8 heavy, whitespace dense)
+                - Allocations: the copying format() call against the in-place call, reported per call
+                - One-pass copies: formatInto() a separate buffer (fused read+convert+write, streaming
+                  stores from 8 MB) against copying first and formatting the copy in place
+                - Arena output: formatView() into a monotonic arena that is released once per batch
+                - Memoization: formatCached() over a small set of repeating tokens, cache on vs off
+                - Incremental edits: formatEdit() of one keystroke in documents from 4 KB to 64 MB
+                - Lazy views: hashing the strategy's view() against hashing a materialized format()
+                - Rule-based title case: RuleTitleCaseFormatter's compiled DFA against plain title case
+                  and against a naive word-by-word implementation of the same rules
+                - Case-insensitive lookup: CaseFoldMap::find() against lowercasing the key first
+                - String columns: columnar::formatColumn() (offsets reused, one sweep over the data)
+                  against formatting a std::string per row and rebuilding the column
+                - Parallel engine: flat split vs topology-aware (NUMA placement, L2-sized chunks,
+                  first-touch output) on one large buffer, with per-node throughput counters
+                - Dispatch overhead: TextProcessor (virtual) vs VariantTextProcessor (std::visit)
+                  vs StaticTextProcessor<F> (inlined), on the same text, plus the hazard-pointer
+                  guard of ConcurrentTextProcessor
+
+Build & run:
+                ./bench.sh                         (builds, then runs everything)
+                ./bench.sh --benchmark_filter=Title   (any Google Benchmark flag is passed through)
+                ./perf.sh check                    (per-commit throughput record + regression check,
+                                                    see bench/perf_regress.py)
+
+Educational Walkthrough Notes:
+                Reported counters:
+                - bytes_per_second:  throughput of one strategy over the input
+                - allocs_per_call:   heap allocations made per formatting call, counted by the global
+                                     operator new replacement below (0 for the in-place API)
+                Inputs are generated before the timed loop starts, so setup cost is never measured.
+*/
+
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <cctype>
+#include <vector>
+#include "TextFormatter.h"
+
+// Allocation Counting
+// Replacing the global operator new/delete is the standard-sanctioned way to observe every heap
+// allocation made by the code under test (std::string, std::vector, std::make_unique, ...)
+// Every form is replaced and counted (scalar and array, throwing and nothrow, over-aligned), and
+// every delete has its replacement, so each new pairs up with the matching delete
+static std::atomic<size_t> allocationCount{0};
+
+static void* countedAllocate(size_t size, size_t alignment) noexcept {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (alignment <= alignof(std::max_align_t))
+        return std::malloc(size ? size : 1);
+    // aligned_alloc() wants a multiple of the alignment
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+static void* countedAllocateOrThrow(size_t size, size_t alignment) {
+    if (void* p = countedAllocate(size, alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size) { return countedAllocateOrThrow(size, 0); }
+void* operator new[](size_t size) { return countedAllocateOrThrow(size, 0); }
+void* operator new(size_t size, std::align_val_t a) { return countedAllocateOrThrow(size, size_t(a)); }
+void* operator new[](size_t size, std::align_val_t a) { return countedAllocateOrThrow(size, size_t(a)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size, 0); }
+void* operator new(size_t size, std::align_val_t a, const std::nothrow_t&) noexcept { return countedAllocate(size, size_t(a)); }
+void* operator new[](size_t size, std::align_val_t a, const std::nothrow_t&) noexcept { return countedAllocate(size, size_t(a)); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+
+namespace {
+
+// Character mixes: each one is a pool of words that the generator strings together
+enum class Mix { Ascii, MixedCase, Utf8Heavy, WhitespaceDense };
+
+const char* mixName(Mix mix) {
+    switch (mix) {
+    case Mix::Ascii:           return "ascii";
+    case Mix::MixedCase:       return "mixed_case";
+    case Mix::Utf8Heavy:       return "utf8_heavy";
+    case Mix::WhitespaceDense: return "whitespace_dense";
+    }
+    return "?";
+}
+
+std::vector<std::string> wordsFor(Mix mix) {
+    switch (mix) {
+    case Mix::Ascii:
+        return {"the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dog ", "strategy ", "pattern "};
+    case Mix::MixedCase:
+        return {"tHe ", "QuIcK ", "BROWN ", "fox ", "JuMpS ", "oVeR ", "LAZY ", "dOg ", "StRaTeGy ", "PATTERN "};
+    case Mix::Utf8Heavy:
+        return {"Straße ", "Ünïcödé ", "Ελληνικά ", "кириллица ", "日本語 ", "naïve ", "café ", "Ωmega ", "ß ", "ÆØÅ "};
+    case Mix::WhitespaceDense:
+        return {"a ", "\tB ", " c\t", "  D\n", "e  ", "\r\nF", " g ", "\v", "h\f", "  "};
+    }
+    return {};
+}
+
+// Builds 'size' bytes of text for a mix: a 64 KB pseudo-random block, then repeated by doubling
+// (a 1 GB input is produced in ~15 memcpy calls instead of millions of appends)
+std::string makeInput(Mix mix, size_t size) {
+    const std::vector<std::string> words = wordsFor(mix);
+    std::mt19937 rng(42);
+    std::string text;
+    text.reserve(size);
+    while (text.size() < std::min<size_t>(size, 64 * 1024))
+        text += words[rng() % words.size()];
+    while (text.size() < size)
+        text.append(text, 0, std::min(text.size(), size - text.size()));
+    text.resize(size);
+    return text;
+}
+
+template <typename F>
+const char* strategyName() {
+    if constexpr (std::is_same_v<F, UpperCaseFormatter>) return "Upper";
+    else if constexpr (std::is_same_v<F, LowerCaseFormatter>) return "Lower";
+    else if constexpr (std::is_same_v<F, Utf8TitleCaseFormatter>) return "Utf8Title";
+    else if constexpr (std::is_same_v<F, RuleTitleCaseFormatter>) return "TitleRules";
+    else return "Title";
+}
+
+void reportCounters(benchmark::State& state, size_t size, size_t allocations) {
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(size));
+    state.counters["allocs_per_call"] = benchmark::Counter(
+        double(allocations) / double(state.iterations() ? state.iterations() : 1));
+}
+
+// Strategy throughput, in-place API (the allocation-free steady state)
+template <typename F>
+void formatInPlace(benchmark::State& state, Mix mix) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    std::string text = makeInput(mix, size);
+    TextProcessor processor;
+    processor.setFormatter(std::make_unique<F>());
+    size_t before = allocationCount.load();
+    for (auto _ : state) {
+        processor.formatInPlace(text);
+        benchmark::DoNotOptimize(text.data());
+        benchmark::ClobberMemory();
+    }
+    reportCounters(state, size, allocationCount.load() - before);
+}
+
+// Source-to-destination formatting into a preallocated buffer of range(0) bytes
+// range(1) == 0: the two-pass baseline (memcpy, then a read-modify-write pass over the copy)
+// range(1) == 1: formatInto(), a single pass for bytewise strategies
+template <typename F>
+void formatIntoBuffer(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    const std::string text = makeInput(Mix::MixedCase, size);
+    std::vector<char> out(size);
+    F formatter;
+    for (auto _ : state) {
+        if (state.range(1)) {
+            formatter.formatInto(text, std::span<char>(out));
+        }
+        else {
+            std::memcpy(out.data(), text.data(), size);
+            formatter.formatSpan(out);
+        }
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    reportCounters(state, size, 0);
+}
+
+// Parallel formatInto() of one large buffer into a freshly allocated, never written one (so the
+// output pages are placed by whoever touches them first, in either C++ standard);
+// range(1) == 0: the flat split (a few chunks per worker, anywhere); range(1) == 1: topology-aware
+// (pinned workers, L2-sized page-aligned chunks on their input's node, output first-touched by
+// the worker filling it)
+// The topology-aware run also reports each NUMA node's throughput and remote share
+void formatParallel(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    const std::string text = makeInput(Mix::MixedCase, size);
+    TextProcessor processor;
+    processor.setTopologyAware(state.range(1) != 0);
+    processor.setFormatter(std::make_unique<TitleCaseFormatter>());
+    std::vector<topology::NodeThroughput> total;
+    for (auto _ : state) {
+        std::unique_ptr<char[]> out = std::make_unique_for_overwrite<char[]>(size);
+        processor.formatInto(format_policy::par, text, std::span<char>(out.get(), size));
+        benchmark::DoNotOptimize(out.get());
+        for (const topology::NodeThroughput& node : processor.nodeThroughput()) {
+            auto it = std::find_if(total.begin(), total.end(), [&](const auto& t) { return t.node == node.node; });
+            if (it == total.end()) it = total.insert(total.end(), topology::NodeThroughput{node.node, node.workers});
+            it->bytes += node.bytes;
+            it->remoteBytes += node.remoteBytes;
+            it->seconds += node.seconds;
+        }
+    }
+    reportCounters(state, size, 0);
+    for (const topology::NodeThroughput& node : total) {
+        std::string prefix = "node" + std::to_string(node.node);
+        state.counters[prefix + "_bytes_per_second"] = node.bytesPerSecond();
+        state.counters[prefix + "_remote_fraction"] = node.bytes ? double(node.remoteBytes) / double(node.bytes) : 0.0;
+    }
+}
+
+// String column of range(0) rows (3..24 bytes each, Arrow layout: int32 offsets + data)
+// range(1) == 0: the row-at-a-time baseline (a std::string per row, then the column rebuilt)
+// range(1) == 1: columnar::formatColumn(), offsets reused and the data formatted in one sweep
+template <typename F>
+void formatStringColumn(benchmark::State& state) {
+    const size_t rows = static_cast<size_t>(state.range(0));
+    const std::string words = makeInput(Mix::MixedCase, rows * 24);
+    std::mt19937 rng(7);
+    std::vector<int32_t> offsets{0};
+    std::string data;
+    for (size_t row = 0, at = 0; row < rows; ++row) {
+        size_t length = 3 + rng() % 22;
+        at = (at + length >= words.size()) ? 0 : at;
+        data.append(words, at, length);
+        at += length;
+        offsets.push_back(static_cast<int32_t>(data.size()));
+    }
+    const columnar::StringColumnView<int32_t> column{std::span<const int32_t>(offsets), data.data()};
+    F formatter;
+    columnar::FormattedColumn<int32_t> out;
+    size_t before = allocationCount.load();
+    for (auto _ : state) {
+        if (state.range(1)) {
+            columnar::formatColumn(formatter, column, out);
+        }
+        else {
+            out.offsets.assign(1, 0);
+            out.data.clear();
+            for (size_t row = 0; row < rows; ++row) {
+                std::string value = formatter.format(std::string(column.value(row)));
+                out.data += value;
+                out.offsets.push_back(static_cast<int32_t>(out.data.size()));
+            }
+        }
+        benchmark::DoNotOptimize(out.data.data());
+        benchmark::ClobberMemory();
+    }
+    reportCounters(state, data.size(), allocationCount.load() - before);
+}
+
+// Strategy throughput, copying API (one result string per call)
+template <typename F>
+void formatCopy(benchmark::State& state, Mix mix) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    const std::string text = makeInput(mix, size);
+    TextProcessor processor;
+    processor.setFormatter(std::make_unique<F>());
+    size_t before = allocationCount.load();
+    for (auto _ : state) {
+        std::string result = processor.format(text);
+        benchmark::DoNotOptimize(result.data());
+    }
+    reportCounters(state, size, allocationCount.load() - before);
+}
+
+// Arena API: a "request" of 64 results is formatted into one monotonic arena, then freed by a
+// single release(); the arena's first block is reused, so steady state makes no heap calls
+template <typename F>
+void formatArena(benchmark::State& state, Mix mix) {
+    constexpr size_t fieldsPerRequest = 64;
+    const size_t size = static_cast<size_t>(state.range(0));
+    const std::string text = makeInput(mix, size);
+    std::vector<char> buffer(fieldsPerRequest * size + 4096);
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+    TextProcessor processor(&arena);
+    processor.setFormatter(std::make_unique<F>());
+    size_t before = allocationCount.load();
+    size_t fields = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(processor.formatView(text).data());
+        if (++fields == fieldsPerRequest) {
+            arena.release();
+            fields = 0;
+        }
+    }
+    reportCounters(state, size, allocationCount.load() - before);
+}
+
+// Memoization: 256 distinct 32-byte UTF-8 heavy tokens requested round-robin (every request after the first
+// lap is a hit when the cache is on); range(0) is 1 for cache on, 0 for cache off
+template <typename F>
+void formatCachedTokens(benchmark::State& state) {
+    std::vector<std::string> tokens;
+    for (int i = 0; i < 256; ++i)
+        tokens.push_back(makeInput(Mix::Utf8Heavy, 28) + std::to_string(1000 + i));
+    TextProcessor processor;
+    processor.setFormatter(std::make_unique<F>());
+    if (state.range(0))
+        processor.enableCache(1024);
+    size_t before = allocationCount.load();
+    size_t next = 0;
+    for (auto _ : state) {
+        auto result = processor.formatCached(tokens[next]);
+        benchmark::DoNotOptimize(result.get());
+        next = (next + 1) % tokens.size();
+    }
+    reportCounters(state, 32, allocationCount.load() - before);
+}
+
+// Incremental edits: one same-length keystroke per iteration; the time should stay flat as the
+// document grows, since only the edited byte and its successor are re-formatted
+template <typename F>
+void formatEditKeystroke(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    std::string input = makeInput(Mix::MixedCase, size);
+    TextProcessor processor;
+    processor.setFormatter(std::make_unique<F>());
+    std::string output = processor.format(input);
+    size_t offset = 0;
+    const char keys[] = {'x', ' ', 'Q'};
+    size_t key = 0;
+    for (auto _ : state) {
+        processor.formatEdit(input, output, offset, 1, std::string_view(&keys[key], 1));
+        benchmark::DoNotOptimize(output.data());
+        offset = (offset + 4099) % size;
+        key = (key + 1) % 3;
+    }
+    reportCounters(state, 1, 0);
+}
+
+// Lazy views: FNV-1a hash of the formatted text; range(1) is 1 for the view, 0 for format()
+uint64_t fnv1a(uint64_t h, char c) { return (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ull; }
+
+template <typename F>
+void hashFormatted(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    const std::string text = makeInput(Mix::MixedCase, size);
+    F formatter;
+    size_t before = allocationCount.load();
+    for (auto _ : state) {
+        uint64_t h = 0xcbf29ce484222325ull;
+        if (state.range(1)) {
+            for (char c : formatter.view(text)) h = fnv1a(h, c);
+        }
+        else {
+            for (char c : formatter.format(text)) h = fnv1a(h, c);
+        }
+        benchmark::DoNotOptimize(h);
+    }
+    reportCounters(state, size, allocationCount.load() - before);
+}
+
+// Dispatch overhead: the same in-place work reached three different ways
+template <typename F>
+void dispatchDynamic(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    std::string text = makeInput(Mix::MixedCase, size);
+    TextProcessor processor;
+    processor.setFormatter(std::make_unique<F>());
+    for (auto _ : state) {
+        processor.formatInPlace(text);
+        benchmark::DoNotOptimize(text.data());
+    }
+    reportCounters(state, size, 0);
+}
+
+template <typename F>
+void dispatchConcurrent(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    std::string text = makeInput(Mix::MixedCase, size);
+    ConcurrentTextProcessor processor;
+    processor.setFormatter(std::make_unique<F>());
+    for (auto _ : state) {
+        processor.formatInPlace(text);
+        benchmark::DoNotOptimize(text.data());
+    }
+    reportCounters(state, size, 0);
+}
+
+template <typename F>
+void dispatchVariant(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    std::string text = makeInput(Mix::MixedCase, size);
+    VariantTextProcessor processor{F{}};
+    for (auto _ : state) {
+        processor.formatInPlace(text);
+        benchmark::DoNotOptimize(text.data());
+    }
+    reportCounters(state, size, 0);
+}
+
+template <typename F>
+void dispatchStatic(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    std::string text = makeInput(Mix::MixedCase, size);
+    StaticTextProcessor<F> processor;
+    for (auto _ : state) {
+        processor.formatInPlace(text);
+        benchmark::DoNotOptimize(text.data());
+    }
+    reportCounters(state, size, 0);
+}
+
+// Case-insensitive lookup of mixed-case keys of range(0) bytes in a 1024-entry map
+// range(1) == 0: lowercase each probe with LowerCaseFormatter, then look it up in a plain map
+// range(1) == 1: look the probe up directly in a CaseFoldMap (fused fold + hash, no copy)
+void caseFoldLookup(benchmark::State& state) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    std::vector<std::string> keys;
+    for (int i = 0; i < 1024; ++i)
+        keys.push_back(std::to_string(100000 + i) + makeInput(Mix::MixedCase, size > 6 ? size - 6 : 0));
+    std::unordered_map<std::string, int> plain;
+    CaseFoldMap<int> folded;
+    LowerCaseFormatter lower;
+    for (int i = 0; i < 1024; ++i) {
+        plain.emplace(lower.format(keys[size_t(i)]), i);
+        folded.emplace(CaseFoldedKey(keys[size_t(i)]), i);
+    }
+    UpperCaseFormatter upper;
+    std::vector<std::string> probes;
+    for (const std::string& k : keys) probes.push_back(upper.format(k));
+
+    size_t before = allocationCount.load();
+    size_t next = 0;
+    for (auto _ : state) {
+        const std::string& probe = probes[next];
+        if (state.range(1))
+            benchmark::DoNotOptimize(folded.find(std::string_view(probe))->second);
+        else
+            benchmark::DoNotOptimize(plain.find(lower.format(probe))->second);
+        next = (next + 1) % probes.size();
+    }
+    reportCounters(state, size, allocationCount.load() - before);
+}
+
+// The rules of RuleTitleCaseFormatter implemented the obvious way, as the baseline for its DFA:
+// split at separators, title-case each word, and look the lowercased word up in a hash set
+void titleRulesNaive(benchmark::State& state, Mix mix) {
+    const size_t size = static_cast<size_t>(state.range(0));
+    std::string text = makeInput(mix, size);
+    const TitleCaseRules rules = TitleCaseRules::english();
+    const std::unordered_set<std::string> stopWords(rules.stopWords.begin(), rules.stopWords.end());
+    size_t before = allocationCount.load();
+    for (auto _ : state) {
+        bool firstWord = true;
+        size_t i = 0;
+        while (i < text.size()) {
+            if (rules.separators.find(text[i]) != std::string::npos) {
+                if (text[i] == '\n') firstWord = true;
+                ++i;
+                continue;
+            }
+            size_t end = i;
+            while (end < text.size() && rules.separators.find(text[end]) == std::string::npos) ++end;
+            std::string word = text.substr(i, end - i);
+            for (char& c : word) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            if (!stopWords.count(word) || firstWord)
+                word[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(word[0])));
+            text.replace(i, word.size(), word);
+            firstWord = false;
+            i = end;
+        }
+        benchmark::DoNotOptimize(text.data());
+        benchmark::ClobberMemory();
+    }
+    reportCounters(state, size, allocationCount.load() - before);
+}
+
+template <typename F>
+void registerStrategy() {
+    const std::string name = strategyName<F>();
+    for (Mix mix : {Mix::Ascii, Mix::MixedCase, Mix::Utf8Heavy, Mix::WhitespaceDense}) {
+        benchmark::RegisterBenchmark((name + "/in_place/" + mixName(mix)).c_str(), formatInPlace<F>, mix)
+            ->RangeMultiplier(16)->Range(16, int64_t(1) << 30)->Unit(benchmark::kMicrosecond);
+        benchmark::RegisterBenchmark((name + "/copy/" + mixName(mix)).c_str(), formatCopy<F>, mix)
+            ->RangeMultiplier(16)->Range(16, int64_t(1) << 20)->Unit(benchmark::kMicrosecond);
+        benchmark::RegisterBenchmark((name + "/arena/" + mixName(mix)).c_str(), formatArena<F>, mix)
+            ->RangeMultiplier(16)->Range(16, int64_t(1) << 16)->Unit(benchmark::kMicrosecond);
+    }
+    benchmark::RegisterBenchmark((name + "/into").c_str(), formatIntoBuffer<F>)
+        ->ArgNames({"size", "one_pass"})->ArgsProduct({{64 << 10, 4 << 20, 64 << 20, 512 << 20}, {0, 1}})
+        ->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark((name + "/cached_tokens").c_str(), formatCachedTokens<F>)
+        ->ArgName("cache")->Arg(0)->Arg(1);
+    benchmark::RegisterBenchmark((name + "/edit_keystroke").c_str(), formatEditKeystroke<F>)
+        ->RangeMultiplier(16)->Range(4 << 10, 64 << 20);
+    benchmark::RegisterBenchmark((name + "/hash").c_str(), hashFormatted<F>)
+        ->ArgNames({"size", "view"})->ArgsProduct({{64, 4 << 10, 256 << 10}, {0, 1}});
+    benchmark::RegisterBenchmark((name + "/column").c_str(), formatStringColumn<F>)
+        ->ArgNames({"rows", "columnar"})->ArgsProduct({{1 << 10, 1 << 16, 1 << 20}, {0, 1}});
+    benchmark::RegisterBenchmark((name + "/dispatch/dynamic").c_str(), dispatchDynamic<F>)
+        ->RangeMultiplier(16)->Range(16, 64 << 10);
+    benchmark::RegisterBenchmark((name + "/dispatch/concurrent").c_str(), dispatchConcurrent<F>)
+        ->RangeMultiplier(16)->Range(16, 64 << 10);
+    benchmark::RegisterBenchmark((name + "/dispatch/variant").c_str(), dispatchVariant<F>)
+        ->RangeMultiplier(16)->Range(16, 64 << 10);
+    benchmark::RegisterBenchmark((name + "/dispatch/static").c_str(), dispatchStatic<F>)
+        ->RangeMultiplier(16)->Range(16, 64 << 10);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    registerStrategy<UpperCaseFormatter>();
+    registerStrategy<LowerCaseFormatter>();
+    registerStrategy<TitleCaseFormatter>();
+    // The UTF-8 strategies cost far more per byte, which is where memoization pays off
+    benchmark::RegisterBenchmark("Utf8Title/cached_tokens", formatCachedTokens<Utf8TitleCaseFormatter>)
+        ->ArgName("cache")->Arg(0)->Arg(1);
+
+    // Title case with separators and stop words: DFA strategy vs the same rules done word by word
+    // (compare with Title/in_place for the cost of the extra rules)
+    for (Mix mix : {Mix::Ascii, Mix::MixedCase}) {
+        benchmark::RegisterBenchmark((std::string("TitleRules/in_place/") + mixName(mix)).c_str(),
+                                     formatInPlace<RuleTitleCaseFormatter>, mix)
+            ->RangeMultiplier(16)->Range(16, int64_t(1) << 24)->Unit(benchmark::kMicrosecond);
+        benchmark::RegisterBenchmark((std::string("TitleRules/naive/") + mixName(mix)).c_str(), titleRulesNaive, mix)
+            ->RangeMultiplier(16)->Range(16, int64_t(1) << 24)->Unit(benchmark::kMicrosecond);
+    }
+
+    benchmark::RegisterBenchmark("CaseFold/lookup", caseFoldLookup)
+        ->ArgNames({"size", "fused"})->ArgsProduct({{8, 32, 256}, {0, 1}});
+
+    benchmark::RegisterBenchmark("Title/parallel", formatParallel)
+        ->ArgNames({"size", "topology"})->ArgsProduct({{16 << 20, 256 << 20}, {0, 1}})
+        ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
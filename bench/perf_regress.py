@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+"""
+File:           perf_regress.py
+Description:    Performance regression harness around the Google Benchmark suite.
+                - record:  runs a fixed subset of TextFormatterBench, keeps the median throughput of
+                           each benchmark, and stores it per commit in perf-results/<commit>.json
+                           (plus one row per benchmark in perf-results/history.csv)
+                - compare: compares two recorded results and exits with status 1 when any benchmark
+                           lost more than --threshold of its throughput
+                - check:   record, then compare against a baseline commit (the parent by default);
+                           this is the one-command form for a CI job
+                - startup: times many short invocations of one or more CLI binaries and prints the
+                           per-invocation latency (record and check track the same numbers for the
+                           --startup binaries, as "Startup/<binary>" entries)
+
+Build & run:
+                ./perf.sh check                          (builds the bench, records HEAD, compares to HEAD~1)
+                ./perf.sh record --repetitions=9
+                ./perf.sh compare main HEAD --threshold=0.05
+                ./perf.sh startup ./textformatter ./textformatter_static
+
+Educational Walkthrough Notes:
+                - Throughput is the median of several repetitions (Google Benchmark's own aggregate),
+                  which ignores the odd preempted run far better than the mean does
+                - The spread of those repetitions (the "cv" aggregate, stddev / mean) is recorded too,
+                  and compare widens the threshold by the spread of both runs: a benchmark that is
+                  itself noisy by 8% cannot prove a 10% regression, a steady one can
+                - Benchmarks without a bytes_per_second counter are scored by items_per_second, or
+                  else by 1 / real_time, so "higher is better" holds for every entry
+                - The default subset (CI_FILTER) sticks to sizes that fit in cache plus one streaming
+                  size: big enough to measure the kernels, small enough to run in about a minute
+                - Startup latency is the wall time of spawning the CLI on a 64-byte input and waiting for
+                  it, so it covers exec, dynamic linking, static initialization and first page faults;
+                  the file cache is warm (truly cold disks need root to drop caches), which is the
+                  case that matters for a script calling the tool in a loop. It is scored as
+                  invocations per second, so "higher is better" holds here too
+                - Results are only comparable on the same machine; the file records the host and CPU
+                  count so a mismatch can be spotted, but the harness does not refuse to compare
+"""
+
+import argparse
+import csv
+import datetime
+import json
+import os
+import platform
+import subprocess
+import statistics
+import sys
+import tempfile
+import time
+
+CI_FILTER = (r"^(Upper|Lower|Title)/in_place/(ascii|mixed_case|whitespace_dense)/(4096|1048576)$"
+             r"|^(Upper|Lower|Title)/into/size:4194304/one_pass:[01]$"
+             r"|^Title/dispatch/(dynamic|variant|static)/4096$"
+             r"|^TitleRules/in_place/ascii/1048576$"
+             r"|^CaseFold/lookup/size:32/fused:1$")
+
+
+def git_commit(ref="HEAD"):
+    try:
+        return subprocess.check_output(["git", "rev-parse", "--short=12", ref], text=True,
+                                       stderr=subprocess.DEVNULL).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def throughput(entry):
+    if "bytes_per_second" in entry:
+        return float(entry["bytes_per_second"])
+    if "items_per_second" in entry:
+        return float(entry["items_per_second"])
+    return 1.0 / float(entry["real_time"])
+
+
+def run_suite(bench, bench_filter, repetitions):
+    command = [bench, "--benchmark_filter=" + bench_filter, "--benchmark_format=json",
+               "--benchmark_repetitions=%d" % repetitions, "--benchmark_report_aggregates_only=true"]
+    output = subprocess.run(command, check=True, stdout=subprocess.PIPE, text=True).stdout
+    report = json.loads(output)
+    results, noise = {}, {}
+    for entry in report["benchmarks"]:
+        name = entry.get("run_name", entry["name"])
+        aggregate = entry.get("aggregate_name")
+        # With one repetition there are no aggregates, only the iteration rows (and no noise estimate)
+        if entry.get("run_type") != "aggregate" or aggregate == "median":
+            results[name] = throughput(entry)
+        elif aggregate == "cv":
+            noise[name] = float(entry["real_time"])
+    if not results:
+        raise SystemExit("perf_regress: the filter matched no benchmarks")
+    return results, noise, report.get("context", {})
+
+
+STARTUP_INPUT = b"the quick BROWN fox\tjumps over\nTHE lazy dog, 64 bytes of a typical line.\n"
+
+
+def run_startup(binaries, repetitions, runs=200):
+    """Median invocations per second (and its cv) of each binary formatting STARTUP_INPUT."""
+    results, noise = {}, {}
+    with tempfile.TemporaryFile() as stdin:
+        stdin.write(STARTUP_INPUT)
+        for binary in binaries:
+            command = [binary, "--mode=title"]
+            rates = []
+            for repetition in range(repetitions + 1):
+                begin = time.perf_counter()
+                for _ in range(runs):
+                    stdin.seek(0)
+                    subprocess.run(command, stdin=stdin, stdout=subprocess.DEVNULL, check=True)
+                if repetition > 0:  # the first group only warms the file cache and the branch predictors
+                    rates.append(runs / (time.perf_counter() - begin))
+            name = "Startup/" + os.path.basename(binary)
+            results[name] = statistics.median(rates)
+            noise[name] = statistics.pstdev(rates) / statistics.mean(rates) if len(rates) > 1 else 0.0
+    return results, noise
+
+
+def startup(args):
+    results, noise = run_startup(args.binaries, args.repetitions)
+    for name, rate in results.items():
+        print("%-40s %8.3f ms per invocation (cv %.1f%%)" % (name, 1e3 / rate, 100.0 * noise[name]))
+    return 0
+
+
+def result_path(results_dir, ref):
+    """A recorded result, given either as a file path or as a commit that was recorded."""
+    if os.path.isfile(ref):
+        return ref
+    commit = git_commit(ref) or ref
+    path = os.path.join(results_dir, commit + ".json")
+    if not os.path.isfile(path):
+        raise SystemExit("perf_regress: no recorded result for '%s' (%s); run record on that commit first"
+                         % (ref, path))
+    return path
+
+
+def record(args):
+    commit = args.commit or git_commit() or "unknown"
+    results, noise, context = run_suite(args.bench, args.filter, args.repetitions)
+    binaries = [b for b in args.startup if os.path.isfile(b)]
+    if binaries:
+        startup_results, startup_noise = run_startup(binaries, args.repetitions)
+        results.update(startup_results)
+        noise.update(startup_noise)
+    os.makedirs(args.results_dir, exist_ok=True)
+    date = datetime.datetime.now(datetime.timezone.utc).isoformat(timespec="seconds")
+    document = {
+        "commit": commit,
+        "date": date,
+        "host": platform.node(),
+        "num_cpus": context.get("num_cpus"),
+        "filter": args.filter,
+        "repetitions": args.repetitions,
+        "results": results,
+        "noise": noise,
+    }
+    path = os.path.join(args.results_dir, commit + ".json")
+    with open(path, "w") as out:
+        json.dump(document, out, indent=2, sort_keys=True)
+        out.write("\n")
+
+    history = os.path.join(args.results_dir, "history.csv")
+    new_file = not os.path.exists(history)
+    with open(history, "a", newline="") as out:
+        writer = csv.writer(out)
+        if new_file:
+            writer.writerow(["commit", "date", "benchmark", "throughput", "cv"])
+        for name, value in sorted(results.items()):
+            writer.writerow([commit, date, name, "%.6g" % value, "%.4f" % noise.get(name, 0.0)])
+    print("perf_regress: recorded %d benchmarks for %s in %s" % (len(results), commit, path))
+    return path
+
+
+def compare(baseline_path, current_path, threshold):
+    with open(baseline_path) as f:
+        baseline = json.load(f)
+    with open(current_path) as f:
+        current = json.load(f)
+    if baseline.get("host") != current.get("host"):
+        print("perf_regress: warning: results come from different hosts (%s vs %s)"
+              % (baseline.get("host"), current.get("host")))
+
+    regressions = 0
+    print("%-55s %14s %14s %8s" % ("benchmark", baseline["commit"], current["commit"], "change"))
+    for name in sorted(set(baseline["results"]) | set(current["results"])):
+        before = baseline["results"].get(name)
+        after = current["results"].get(name)
+        if before is None or after is None:
+            print("%-55s %14s %14s %8s" % (name, "-" if before is None else "%.4g" % before,
+                                           "-" if after is None else "%.4g" % after, "n/a"))
+            continue
+        change = after / before - 1.0
+        allowed = threshold + baseline.get("noise", {}).get(name, 0.0) + current.get("noise", {}).get(name, 0.0)
+        verdict = ""
+        if change < -allowed:
+            verdict = "  REGRESSION"
+            regressions += 1
+        print("%-55s %14.4g %14.4g %+7.1f%% (allowed -%.1f%%)%s"
+              % (name, before, after, 100.0 * change, 100.0 * allowed, verdict))
+
+    if regressions:
+        print("perf_regress: %d benchmark(s) slower by more than %.0f%% plus their measured noise"
+              % (regressions, 100.0 * threshold))
+        return 1
+    print("perf_regress: no regression beyond %.0f%%" % (100.0 * threshold))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Record benchmark throughput per commit and detect regressions.")
+    parser.add_argument("--results-dir", default="perf-results", help="where results are stored (default: perf-results)")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    def add_run_options(p):
+        p.add_argument("--bench", default="./textformatter_bench", help="benchmark binary (default: ./textformatter_bench)")
+        p.add_argument("--filter", default=CI_FILTER, help="Google Benchmark filter (default: the CI subset)")
+        p.add_argument("--repetitions", type=int, default=5, help="repetitions per benchmark; the median is kept")
+        p.add_argument("--commit", help="label for the result (default: git rev-parse HEAD)")
+        p.add_argument("--startup", action="append", default=None,
+                       help="CLI binary whose startup latency is tracked too (repeatable; default: "
+                            "./textformatter and ./textformatter_static, where they exist)")
+
+    add_run_options(commands.add_parser("record", help="run the suite and store the result"))
+
+    p = commands.add_parser("compare", help="compare two recorded results")
+    p.add_argument("baseline", help="recorded commit or result file")
+    p.add_argument("current", help="recorded commit or result file")
+    p.add_argument("--threshold", type=float, default=0.10, help="allowed slowdown, as a fraction (default: 0.10)")
+
+    p = commands.add_parser("check", help="record, then compare against a baseline")
+    add_run_options(p)
+    p.add_argument("--baseline", default="HEAD~1", help="recorded commit or result file (default: HEAD~1)")
+    p.add_argument("--threshold", type=float, default=0.10, help="allowed slowdown, as a fraction (default: 0.10)")
+
+    p = commands.add_parser("startup", help="print the per-invocation latency of CLI binaries")
+    p.add_argument("binaries", nargs="+", help="binaries to run with --mode=title on a 64-byte input")
+    p.add_argument("--repetitions", type=int, default=5, help="groups of 200 invocations; the median is kept")
+
+    args = parser.parse_args()
+    if args.command == "startup":
+        return startup(args)
+    if args.startup is None:
+        args.startup = ["./textformatter", "./textformatter_static"]
+    if args.command == "record":
+        record(args)
+        return 0
+    if args.command == "compare":
+        return compare(result_path(args.results_dir, args.baseline),
+                       result_path(args.results_dir, args.current), args.threshold)
+    # check: resolve the baseline first, so a missing one fails before the suite runs
+    baseline = result_path(args.results_dir, args.baseline)
+    return compare(baseline, record(args), args.threshold)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,44 @@
+#!/bin/bash
+
+# Statically linked, LTO- and PGO-optimized build of the command-line tool: textformatter_static
+# 1. an instrumented build (-fprofile-generate) runs a training workload: short streaming runs
+#    of every mode, a large stream, file mode and a parallel file run
+# 2. the final build (-fprofile-use) lays out hot code from those profiles, inlines across the
+#    whole program (-flto) and links everything statically (-static): no dynamic loader, no
+#    symbol relocation at startup, which is most of the cold-start cost of a short invocation
+# Plugins (--plugin) need the dynamic build: a static binary cannot share its C++ runtime with a
+# loaded library, and the linker warns about dlopen/getaddrinfo for that reason.
+#   ./build-static.sh                    (then: ./perf.sh startup ./textformatter ./textformatter_static)
+#   CXX=g++-14 ./build-static.sh
+CXX=${CXX:-g++}
+FLAGS="-std=c++20 -O2 -pthread -flto=auto"
+PROFILE_DIR=$(mktemp -d)
+trap 'rm -rf "$PROFILE_DIR"' EXIT
+
+# The instrumented binary gets the final output name: GCC names the profile files after it, and
+# -fprofile-use only finds them under the same name
+"$CXX" $FLAGS -fprofile-generate -fprofile-update=prefer-atomic -fprofile-dir="$PROFILE_DIR" \
+    src/Pattern-Strategy-TextFormatter.cpp -o textformatter_static -ldl || exit 1
+
+# Training workload: representative of how the tool is called, not of any single benchmark
+train=./textformatter_static
+sample="$PROFILE_DIR/sample.txt"
+head -c 3000000 /dev/urandom | base64 -w 76 | tr '+/0123' '  \t   ' > "$sample"
+for mode in upper lower title utf8-upper utf8-lower utf8-title title-rules lower,title none; do
+    for i in $(seq 20); do
+        printf 'tHiS iS a TeSt, hELLO u$3r@bC! straße ÉLAN\n' | "$train" --mode=$mode > /dev/null
+    done
+    "$train" --mode=$mode < "$sample" > /dev/null
+done
+for mode in upper lower title; do
+    "$train" --mode=$mode --input="$sample" --output="$PROFILE_DIR/out.txt"
+    "$train" --mode=$mode --threads=4 --input="$sample" --output="$PROFILE_DIR/out.txt"
+done
+
+"$CXX" $FLAGS -static -fprofile-use -fprofile-correction -fprofile-dir="$PROFILE_DIR" \
+    src/Pattern-Strategy-TextFormatter.cpp -o textformatter_static -ldl 2> "$PROFILE_DIR/link.log" || {
+    cat "$PROFILE_DIR/link.log"
+    exit 1
+}
+grep -v "statically linked applications requires at runtime" "$PROFILE_DIR/link.log" | grep -v "in function" >&2
+echo "build-static.sh: built textformatter_static"
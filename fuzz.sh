@@ -0,0 +1,31 @@
+#!/bin/bash
+
+# Differential fuzzing of every accelerated path against the scalar reference
+# (fuzz/DifferentialFuzz.cpp). With a clang that supports -fsanitize=fuzzer this runs libFuzzer
+# (coverage-guided, corpus kept in fuzz/corpus); otherwise the standalone driver runs its
+# random and adversarial generator under AddressSanitizer and UndefinedBehaviorSanitizer.
+#   FUZZ_SECONDS=600 ./fuzz.sh            (default 60 seconds of libFuzzer)
+#   ./fuzz.sh crash-1234abcd              (replay inputs, e.g. a crash file libFuzzer wrote)
+FUZZ_SECONDS=${FUZZ_SECONDS:-60}
+CXX_FUZZ=${CXX_FUZZ:-clang++}
+
+if echo 'extern "C" int LLVMFuzzerTestOneInput(const unsigned char*, unsigned long) { return 0; }' |
+   "$CXX_FUZZ" -x c++ -fsanitize=fuzzer - -o /dev/null 2> /dev/null; then
+    "$CXX_FUZZ" -std=c++20 -O1 -g -pthread -fsanitize=fuzzer,address,undefined -DTEXTFORMATTER_LIBFUZZER \
+        -Isrc fuzz/DifferentialFuzz.cpp -o textformatter_fuzz_libfuzzer || exit 1
+    if [ $# -gt 0 ]; then
+        ./textformatter_fuzz_libfuzzer "$@"
+    else
+        mkdir -p fuzz/corpus
+        ./textformatter_fuzz_libfuzzer -max_total_time="$FUZZ_SECONDS" -max_len=65536 fuzz/corpus
+    fi
+else
+    echo "fuzz.sh: $CXX_FUZZ -fsanitize=fuzzer unavailable, running the standalone driver instead"
+    g++ -std=c++20 -O1 -g -pthread -fsanitize=address,undefined -fno-sanitize-recover=undefined \
+        -Isrc fuzz/DifferentialFuzz.cpp -o textformatter_fuzz_asan || exit 1
+    if [ $# -gt 0 ]; then
+        ./textformatter_fuzz_asan "$@"
+    else
+        ./textformatter_fuzz_asan --iterations="${FUZZ_ITERATIONS:-20000}" --seed="${FUZZ_SEED:-$RANDOM}"
+    fi
+fi
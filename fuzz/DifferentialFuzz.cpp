@@ -0,0 +1,593 @@
+/*
+File:           DifferentialFuzz.cpp
+Description:    Differential fuzz target: every accelerated code path against a scalar reference.
+                - The reference is written here from the specification ("C" locale, byte by byte),
+                  independently of the library, so a bug shared by all library paths still shows up
+                - Checked against it: each SIMD kernel (scalar, SSE2, AVX2, AVX-512, NEON, with and
+                  without streaming stores), the strategies' in-place, copying, buffer and chunked
+                  entry points, the table (non-SIMD) loops, lazy views, batches, pipelines, the
+                  static and variant contexts (and that they bind locale tables like TextProcessor),
+                  the parallel engine, incremental edits, the rule-based title case without rules,
+                  the UTF-8 strategies on ASCII, and case-folded hashing
+                - The columnar adapter is checked row by row against each strategy's own format()
+                - The UTF-8 strategies have no independent reference for non-ASCII text, so for them
+                  the entry points are checked against each other (same bytes, same size)
+
+Build & run:
+                ./fuzz.sh                        (libFuzzer with clang, else the standalone driver)
+                libFuzzer:  clang++ -std=c++20 -O1 -g -fsanitize=fuzzer,address,undefined
+                            -DTEXTFORMATTER_LIBFUZZER -Isrc fuzz/DifferentialFuzz.cpp -o textformatter_fuzz
+                Standalone: g++ -std=c++20 -O2 -pthread -Isrc fuzz/DifferentialFuzz.cpp -o textformatter_fuzz
+                            ./textformatter_fuzz [--iterations=N] [--seed=S] [FILE...]
+
+Educational Walkthrough Notes:
+                - The first input byte is not text: it seeds the split points, buffer offsets and
+                  edits, so the fuzzer explores those choices together with the text itself
+                - The standalone driver (no libFuzzer needed) generates random and adversarial
+                  inputs: lengths around every vector width, whitespace exactly at block and chunk
+                  boundaries, high-bit bytes and broken UTF-8, empty strings; given FILE arguments
+                  it replays them instead, so a libFuzzer crash file can be reproduced with g++
+                - A mismatch prints the check, the input length and the first differing offset,
+                  then aborts, which libFuzzer records as a crash together with the input
+*/
+
+#include <algorithm>
+#include <clocale>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "TextFormatter.h"
+
+namespace {
+
+// Reference Semantics
+// Straight from the definitions: only 'a'..'z' / 'A'..'Z' change, whitespace is the six
+// isspace() bytes of the "C" locale, and a word starts after whitespace (or at the start)
+enum class Rule { Upper, Lower, Title };
+
+bool isSpace(unsigned char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+std::string reference(std::string_view text, Rule rule, char preceding = ' ') {
+    std::string out(text);
+    bool wordStart = isSpace(static_cast<unsigned char>(preceding));
+    for (char& ch : out) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        bool toUpper = rule == Rule::Upper || (rule == Rule::Title && wordStart);
+        if (toUpper && c >= 'a' && c <= 'z') ch = static_cast<char>(c - 0x20);
+        if (!toUpper && rule != Rule::Upper && c >= 'A' && c <= 'Z') ch = static_cast<char>(c + 0x20);
+        wordStart = isSpace(c);
+    }
+    return out;
+}
+
+const char* ruleName(Rule rule) {
+    return rule == Rule::Upper ? "upper" : rule == Rule::Lower ? "lower" : "title";
+}
+
+[[noreturn]] void mismatch(const char* check, std::string_view input, std::string_view expected, std::string_view actual) {
+    size_t at = 0;
+    while (at < expected.size() && at < actual.size() && expected[at] == actual[at]) ++at;
+    fprintf(stderr, "MISMATCH in %s: input length %zu, expected length %zu, got length %zu, first difference at %zu\n",
+            check, input.size(), expected.size(), actual.size(), at);
+    if (at < expected.size() && at < actual.size())
+        fprintf(stderr, "  input 0x%02x, expected 0x%02x, got 0x%02x\n", static_cast<unsigned char>(input[at]),
+                static_cast<unsigned char>(expected[at]), static_cast<unsigned char>(actual[at]));
+    abort();
+}
+
+void expectEqual(const char* check, std::string_view input, std::string_view expected, std::string_view actual) {
+    if (expected != actual)
+        mismatch(check, input, expected, actual);
+}
+
+// Deterministic choices derived from the seed byte (split points, offsets, edit positions)
+struct Choices {
+    std::minstd_rand rng;
+    explicit Choices(unsigned seed) : rng(seed + 1) {}
+    size_t below(size_t n) { return n == 0 ? 0 : rng() % n; }
+};
+
+// Kernel Checks
+// Every kernel the CPU can run is called directly, whatever the dispatcher would pick, with the
+// destination either in place or in a separate buffer at an offset (streaming stores need a
+// 64-byte aligned destination, so that variant gets an aligned one)
+using ConvertFn = ascii_kernels::KernelFn;
+using TitleFn = ascii_kernels::TitleKernelFn;
+
+struct NamedKernels {
+    std::vector<std::pair<const char*, ConvertFn>> convert;
+    std::vector<std::pair<const char*, TitleFn>> title;
+    std::vector<bool> streaming;
+};
+
+const NamedKernels& availableKernels() {
+    static const NamedKernels kernels = [] {
+        NamedKernels k;
+        auto add = [&](const char* name, ConvertFn c, TitleFn t, bool stream) {
+            k.convert.emplace_back(name, c);
+            k.title.emplace_back(name, t);
+            k.streaming.push_back(stream);
+        };
+        add("scalar", ascii_kernels::convertScalar, ascii_kernels::titleScalar, false);
+#if defined(__SSE2__)
+        add("sse2", ascii_kernels::convertSse2<false>, ascii_kernels::titleSse2<false>, false);
+        add("sse2-stream", ascii_kernels::convertSse2<true>, ascii_kernels::titleSse2<true>, true);
+#endif
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            add("avx2", ascii_kernels::convertAvx2<false>, ascii_kernels::titleAvx2<false>, false);
+            add("avx2-stream", ascii_kernels::convertAvx2<true>, ascii_kernels::titleAvx2<true>, true);
+        }
+        if (__builtin_cpu_supports("avx512bw")) {
+            add("avx512", ascii_kernels::convertAvx512<false>, ascii_kernels::titleAvx512<false>, false);
+            add("avx512-stream", ascii_kernels::convertAvx512<true>, ascii_kernels::titleAvx512<true>, true);
+        }
+#endif
+#if defined(__ARM_NEON)
+        add("neon", ascii_kernels::convertNeon<false>, ascii_kernels::titleNeon<false>, false);
+#endif
+        return k;
+    }();
+    return kernels;
+}
+
+void checkKernels(std::string_view text, const std::string (&expected)[3], Choices& choices) {
+    const NamedKernels& kernels = availableKernels();
+    // 64-byte aligned scratch with room for an offset and a guard byte on each side
+    std::vector<char> storage(text.size() + 192);
+    char* aligned = storage.data() + (-reinterpret_cast<uintptr_t>(storage.data()) & 63) + 64;
+    for (size_t k = 0; k < kernels.convert.size(); ++k) {
+        size_t offset = kernels.streaming[k] ? 0 : choices.below(64);
+        char* dst = aligned + offset;
+        for (int r = 0; r < 3; ++r) {
+            Rule rule = static_cast<Rule>(r);
+            dst[-1] = dst[text.size()] = '#';
+            if (rule == Rule::Title)
+                kernels.title[k].second(text.data(), dst, text.size(), true);
+            else
+                kernels.convert[k].second(text.data(), dst, text.size(), rule == Rule::Upper ? 'a' : 'A');
+            std::string check = std::string("kernel ") + kernels.convert[k].first + " " + ruleName(rule) + " (copy)";
+            expectEqual(check.c_str(), text, expected[r], std::string_view(dst, text.size()));
+            if (dst[-1] != '#' || dst[text.size()] != '#')
+                mismatch((check + " wrote outside its buffer").c_str(), text, "", "");
+            if (kernels.streaming[k])
+                continue;
+            std::string inPlace(text);
+            if (rule == Rule::Title)
+                kernels.title[k].second(inPlace.data(), inPlace.data(), inPlace.size(), true);
+            else
+                kernels.convert[k].second(inPlace.data(), inPlace.data(), inPlace.size(), rule == Rule::Upper ? 'a' : 'A');
+            check = std::string("kernel ") + kernels.convert[k].first + " " + ruleName(rule) + " (in place)";
+            expectEqual(check.c_str(), text, expected[r], inPlace);
+        }
+    }
+}
+
+// Strategy Checks
+// Every public entry point of one strategy object, against the reference for its rule
+template <typename F>
+void checkStrategy(F& f, const char* name, Rule rule, std::string_view text, Choices& choices) {
+    const std::string expected = reference(text, rule);
+    const std::string input(text);
+    auto label = [&](const char* what) { return std::string(name) + " " + what; };
+
+    expectEqual(label("format").c_str(), text, expected, f.format(input));
+    std::string copy = input;
+    f.formatInPlace(copy);
+    expectEqual(label("formatInPlace").c_str(), text, expected, copy);
+
+    std::string out = "stale contents of a reused buffer";
+    f.formatInto(text, out);
+    expectEqual(label("formatInto(string)").c_str(), text, expected, out);
+
+    std::vector<char> buffer(text.size() + 72, '#');
+    size_t offset = choices.below(64);
+    size_t written = f.formatInto(text, std::span<char>(buffer.data() + offset, text.size()));
+    expectEqual(label("formatInto(span)").c_str(), text, expected, std::string_view(buffer.data() + offset, written));
+    if ((offset > 0 && buffer[offset - 1] != '#') || buffer[offset + text.size()] != '#')
+        mismatch(label("formatInto(span) wrote outside its buffer").c_str(), text, "", "");
+
+    // Chunked, at random split points, both in place and source-to-destination
+    if (f.supportsChunking()) {
+        std::string chunked = input;
+        std::string fused(text.size(), '?');
+        size_t begin = 0;
+        while (begin < text.size()) {
+            size_t length = 1 + choices.below(std::min<size_t>(text.size() - begin, 97));
+            char preceding = begin == 0 ? ' ' : text[begin - 1];
+            f.formatChunk(std::span<char>(chunked).subspan(begin, length), preceding);
+            f.formatChunkInto(text.substr(begin, length), std::span<char>(fused).subspan(begin, length), preceding);
+            begin += length;
+        }
+        expectEqual(label("formatChunk").c_str(), text, expected, chunked);
+        expectEqual(label("formatChunkInto").c_str(), text, expected, fused);
+    }
+
+    // Batch: split into strings, each formatted as its own text
+    std::vector<std::string_view> pieces;
+    for (size_t begin = 0; begin < text.size();) {
+        size_t length = choices.below(std::min<size_t>(text.size() - begin, 40)) + 1;
+        pieces.push_back(text.substr(begin, length));
+        begin += length;
+    }
+    pieces.push_back(std::string_view());
+    FormattedBatch batch;
+    f.formatBatch(pieces, batch);
+    for (size_t i = 0; i < pieces.size(); ++i)
+        expectEqual(label("formatBatch").c_str(), pieces[i], reference(pieces[i], rule), batch[i]);
+}
+
+// String columns: the text cut into rows (some empty) behind a random lead-in, formatted by the
+// columnar adapter; every row must come out as if it had been formatted on its own
+template <typename F>
+void checkColumn(const char* name, std::string_view text, Choices& choices) {
+    F f;
+    std::vector<int32_t> offsets{static_cast<int32_t>(choices.below(4))};
+    std::string data(static_cast<size_t>(offsets[0]), 'x');
+    for (size_t begin = 0; begin < text.size();) {
+        size_t length = choices.below(8) == 0 ? 0 : 1 + choices.below(std::min<size_t>(text.size() - begin, 24));
+        data.append(text.substr(begin, length));
+        offsets.push_back(static_cast<int32_t>(data.size()));
+        begin += length;
+    }
+    columnar::StringColumnView<int32_t> column{std::span<const int32_t>(offsets), data.data()};
+    columnar::FormattedColumn<int32_t> out;
+    columnar::formatColumn(f, column, out);
+    std::string label = std::string(name) + " formatColumn";
+    for (size_t row = 0; row < column.rows(); ++row) {
+        const std::vector<int32_t>& o = out.offsetsReused ? offsets : out.offsets;
+        std::string_view got(out.data.data() + o[row], static_cast<size_t>(o[row + 1] - o[row]));
+        expectEqual(label.c_str(), column.value(row), f.format(std::string(column.value(row))), got);
+    }
+    if (f.isLengthPreserving()) {
+        std::string inPlace = data;
+        columnar::formatColumnInPlace<int32_t>(f, offsets, inPlace.data());
+        expectEqual((label + "InPlace").c_str(), data, std::string_view(out.data).substr(size_t(offsets[0])),
+                    std::string_view(inPlace).substr(size_t(offsets[0])));
+    }
+
+    // Malformed offsets (one negative, or one larger than the next) must be rejected with
+    // std::invalid_argument by the length-preserving and the length-changing path alike, before
+    // any row is read through them
+    if (column.rows() < 2)
+        return;
+    size_t row = 1 + choices.below(column.rows() - 1);
+    for (int32_t bad : {int32_t(-1), offsets[row + 1] + 1}) {
+        std::vector<int32_t> broken = offsets;
+        broken[row] = bad;
+        columnar::StringColumnView<int32_t> malformed{std::span<const int32_t>(broken), data.data()};
+        bool rejected = false;
+        try {
+            columnar::formatColumn(f, malformed, out);
+        }
+        catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        if (!rejected)
+            mismatch((label + " accepted malformed offsets").c_str(), text, "std::invalid_argument", "no exception");
+    }
+}
+
+// The same strategy driven through its character tables instead of the SIMD kernels: tables
+// identical to "C" but not marked ascii, which is what a non-"C" locale looks like to the code
+template <typename F>
+void checkTableLoop(const char* name, Rule rule, std::string_view text, Choices& choices) {
+    static const std::shared_ptr<const CaseTables> tables = [] {
+        auto t = std::make_shared<CaseTables>(makeAsciiCaseTables());
+        t->ascii = false;
+        return std::shared_ptr<const CaseTables>(std::move(t));
+    }();
+    F f;
+    f.useCaseTables(tables);
+    checkStrategy(f, name, rule, text, choices);
+}
+
+template <typename F>
+void checkView(const char* name, Rule rule, std::string_view text) {
+    F f;
+    auto view = f.view(text);
+    std::string viewed(view.begin(), view.end());
+    expectEqual((std::string(name) + " view").c_str(), text, reference(text, rule), viewed);
+}
+
+// Context Checks: the contexts must agree with the bare strategy
+// format(std::string&&) on the concrete type must format the moved-in buffer and hand that very
+// buffer back (no allocation); only checked past the small-string buffer, where there is one
+template <typename F>
+void checkMoveReuse(const char* name, std::string_view text, const std::string& expected, F&& f = F()) {
+    if (text.size() <= std::string().capacity())
+        return;
+    std::string moved(text);
+    const char* storage = moved.data();
+    std::string result = f.format(std::move(moved));
+    expectEqual((std::string(name) + " format(&&)").c_str(), text, expected, result);
+    if (result.data() != storage)
+        mismatch((std::string(name) + " format(&&) reallocated").c_str(), text, expected, result);
+}
+
+// A strategy handed to a context's constructor must be bound to the active locale's tables just
+// like one passed to setFormatter(), so every context formats alike. Under the "C" locale this is
+// a plain agreement check; checkLocaleBinding() repeats it under a Latin-1 locale when the host
+// has one, where the tables (and so the results) really differ
+void checkBinding(std::string_view text, const char* locale) {
+    const std::string input(text);
+    std::string check = std::string("context binding (") + locale + ")";
+    TextProcessor upper, lower, title;
+    upper.setFormatter(std::make_unique<UpperCaseFormatter>());
+    lower.setFormatter(std::make_unique<LowerCaseFormatter>());
+    title.setFormatter(std::make_unique<TitleCaseFormatter>());
+    const std::string expectedUpper = upper.format(input), expectedTitle = title.format(input);
+    StaticTextProcessor<UpperCaseFormatter> staticUpper;
+    expectEqual((check + " StaticTextProcessor<upper>()").c_str(), text, expectedUpper, staticUpper.format(input));
+    StaticTextProcessor<TitleCaseFormatter> staticTitle{TitleCaseFormatter{}};
+    expectEqual((check + " StaticTextProcessor<title>(f)").c_str(), text, expectedTitle, staticTitle.format(input));
+    VariantTextProcessor constructed(LowerCaseFormatter{});
+    VariantTextProcessor assigned;
+    assigned.setFormatter(LowerCaseFormatter{});
+    expectEqual((check + " VariantTextProcessor(f)").c_str(), text, lower.format(input), constructed.format(input));
+    expectEqual((check + " VariantTextProcessor::setFormatter").c_str(), text, lower.format(input), assigned.format(input));
+}
+
+void checkLocaleBinding(std::string_view text) {
+    static const char* latin1 = [] {
+        for (const char* name : {"en_US.ISO-8859-1", "en_US.iso88591", "de_DE.ISO-8859-1", "fr_FR.ISO-8859-1"})
+            if (setlocale(LC_CTYPE, name)) {
+                setlocale(LC_CTYPE, "C");
+                return name;
+            }
+        return static_cast<const char*>(nullptr);
+    }();
+    if (!latin1)
+        return;
+    setlocale(LC_CTYPE, latin1);
+    checkBinding(text, latin1);
+    setlocale(LC_CTYPE, "C");
+}
+
+void checkContexts(std::string_view text, const std::string (&expected)[3], Choices& choices) {
+    const std::string input(text);
+    StaticTextProcessor<UpperCaseFormatter> staticUpper;
+    expectEqual("StaticTextProcessor<upper>", text, expected[0], staticUpper.format(input));
+    StaticTextProcessor<TitleCaseFormatter> staticTitle;
+    expectEqual("StaticTextProcessor<title>", text, expected[2], staticTitle.format(input));
+    VariantTextProcessor variant(LowerCaseFormatter{});
+    expectEqual("VariantTextProcessor<lower>", text, expected[1], variant.format(input));
+
+    auto pipeline = std::make_unique<CompositeFormatter>();
+    pipeline->add(std::make_unique<UpperCaseFormatter>()).add(std::make_unique<TitleCaseFormatter>());
+    expectEqual("pipeline upper,title", text, expected[2], pipeline->format(input));
+
+    RuleTitleCaseFormatter noRules(TitleCaseRules{});
+    expectEqual("title-rules without stop words", text, expected[2], noRules.format(input));
+
+    TextProcessor processor;
+    processor.setFormatter(std::make_unique<TitleCaseFormatter>());
+    expectEqual("TextProcessor format(par)", text, expected[2], processor.format(format_policy::par, input));
+    std::string parallel = input;
+    processor.formatInPlace(format_policy::par, parallel);
+    expectEqual("TextProcessor formatInPlace(par)", text, expected[2], parallel);
+
+    // Incremental edit: replace a random range with a random slice of the text itself
+    std::string document = input, formatted = expected[2];
+    size_t offset = choices.below(text.size() + 1);
+    size_t length = choices.below(text.size() - offset + 1);
+    size_t from = choices.below(text.size() + 1);
+    std::string_view replacement = text.substr(from, choices.below(text.size() - from + 1));
+    processor.formatEdit(document, formatted, offset, length, replacement);
+    expectEqual("TextProcessor formatEdit", document, reference(document, Rule::Title), formatted);
+}
+
+// UTF-8 strategies: on pure ASCII they must equal the ASCII reference; on anything else their
+// entry points must at least agree with each other (and never write outside the sized buffer)
+template <typename F>
+void checkUtf8(const char* name, Rule rule, std::string_view text) {
+    F f;
+    const std::string input(text);
+    const std::string formatted = f.format(input);
+    if (std::all_of(text.begin(), text.end(), [](char c) { return static_cast<unsigned char>(c) < 0x80; }))
+        expectEqual(name, text, reference(text, rule), formatted);
+    if (f.formattedSize(text) != formatted.size())
+        mismatch((std::string(name) + " formattedSize").c_str(), text, formatted, "");
+    std::string copy = input;
+    f.formatInPlace(copy);
+    expectEqual((std::string(name) + " formatInPlace").c_str(), text, formatted, copy);
+    std::vector<char> buffer(formatted.size() + 1, '#');
+    size_t written = f.formatInto(text, std::span<char>(buffer.data(), formatted.size()));
+    expectEqual((std::string(name) + " formatInto(span)").c_str(), text, formatted, std::string_view(buffer.data(), written));
+    if (buffer[formatted.size()] != '#')
+        mismatch((std::string(name) + " formatInto(span) wrote outside its buffer").c_str(), text, "", "");
+}
+
+// Case-folded keys: equal exactly when the lowercase forms are equal, and then equal hashes
+void checkCaseFold(std::string_view text, const std::string (&expected)[3]) {
+    if (!case_fold::equal(text, expected[0]) || case_fold::hash(text) != case_fold::hash(expected[0]))
+        mismatch("case_fold upper vs original", text, "equal", "different");
+    if (!text.empty()) {
+        std::string changed(text);
+        changed[changed.size() / 2] ^= 0x01;
+        bool foldEqual = reference(changed, Rule::Lower) == expected[1];
+        if (case_fold::equal(text, changed) != foldEqual)
+            mismatch("case_fold equal on a one-bit change", text, foldEqual ? "equal" : "different", "");
+    }
+}
+
+void checkAll(std::string_view text, unsigned seed) {
+    Choices choices(seed);
+    const std::string expected[3] = {reference(text, Rule::Upper), reference(text, Rule::Lower), reference(text, Rule::Title)};
+
+    checkKernels(text, expected, choices);
+
+    UpperCaseFormatter upper;
+    LowerCaseFormatter lower;
+    TitleCaseFormatter title;
+    checkStrategy(upper, "upper", Rule::Upper, text, choices);
+    checkStrategy(lower, "lower", Rule::Lower, text, choices);
+    checkStrategy(title, "title", Rule::Title, text, choices);
+    checkTableLoop<UpperCaseFormatter>("upper (tables)", Rule::Upper, text, choices);
+    checkTableLoop<LowerCaseFormatter>("lower (tables)", Rule::Lower, text, choices);
+    checkTableLoop<TitleCaseFormatter>("title (tables)", Rule::Title, text, choices);
+    checkView<UpperCaseFormatter>("upper", Rule::Upper, text);
+    checkView<LowerCaseFormatter>("lower", Rule::Lower, text);
+    checkView<TitleCaseFormatter>("title", Rule::Title, text);
+
+    checkMoveReuse<UpperCaseFormatter>("upper", text, expected[0]);
+    checkMoveReuse<LowerCaseFormatter>("lower", text, expected[1]);
+    checkMoveReuse<TitleCaseFormatter>("title", text, expected[2]);
+    CompositeFormatter pipeline;
+    pipeline.add(std::make_unique<LowerCaseFormatter>()).add(std::make_unique<TitleCaseFormatter>());
+    checkMoveReuse<CompositeFormatter&>("pipeline lower,title", text, expected[2], pipeline);
+    // On ASCII no character changes its byte length, so the UTF-8 strategies work in place too
+    if (std::all_of(text.begin(), text.end(), [](char c) { return static_cast<unsigned char>(c) < 0x80; })) {
+        checkMoveReuse<Utf8UpperCaseFormatter>("utf8-upper", text, expected[0]);
+        checkMoveReuse<Utf8LowerCaseFormatter>("utf8-lower", text, expected[1]);
+        checkMoveReuse<Utf8TitleCaseFormatter>("utf8-title", text, expected[2]);
+    }
+    checkContexts(text, expected, choices);
+    checkBinding(text, "C");
+    checkLocaleBinding(text);
+
+    checkColumn<UpperCaseFormatter>("upper", text, choices);
+    checkColumn<TitleCaseFormatter>("title", text, choices);
+    checkColumn<RuleTitleCaseFormatter>("title-rules", text, choices);
+    checkColumn<Utf8TitleCaseFormatter>("utf8-title", text, choices);
+
+    checkUtf8<Utf8UpperCaseFormatter>("utf8-upper", Rule::Upper, text);
+    checkUtf8<Utf8LowerCaseFormatter>("utf8-lower", Rule::Lower, text);
+    checkUtf8<Utf8TitleCaseFormatter>("utf8-title", Rule::Title, text);
+
+    checkCaseFold(text, expected);
+}
+
+// Input decoding shared by libFuzzer and the standalone driver: seed byte, then the text
+// A seed with its top two bits set also repeats the text past the parallel engine's threshold
+// (and past the streaming-store threshold), so those paths see fuzzed content too
+void runOne(const uint8_t* data, size_t size) {
+    if (size == 0) {
+        checkAll(std::string_view(), 0);
+        return;
+    }
+    unsigned seed = data[0];
+    std::string_view text(reinterpret_cast<const char*>(data + 1), size - 1);
+    checkAll(text, seed);
+    if ((seed & 0xC0) == 0xC0 && !text.empty() && text.size() < 4096) {
+        std::string big;
+        while (big.size() < ascii_kernels::nonTemporalThreshold + 3 * TextProcessor::minParallelChunk)
+            big += text;
+        const std::string expected = reference(big, Rule::Title);
+        TextProcessor processor;
+        processor.setFormatter(std::make_unique<TitleCaseFormatter>());
+        expectEqual("TextProcessor format(par), large", big, expected, processor.format(format_policy::par, big));
+        TitleCaseFormatter title;
+        std::string out;
+        title.formatInto(big, out);
+        expectEqual("title formatInto, large", big, expected, out);
+    }
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    runOne(data, size);
+    return 0;
+}
+
+#if !defined(TEXTFORMATTER_LIBFUZZER)
+namespace {
+
+// Adversarial generator for the standalone driver
+std::string generate(std::mt19937& rng) {
+    static const std::string spaces = " \t\n\v\f\r";
+    static const char* utf8[] = {"\xC3\x9F", "\xC3\x80", "\xCE\xA9", "\xD0\xBA", "\xE6\x97\xA5", "\xF0\x9F\x98\x80",
+                                 "\xC3", "\xE6\x97", "\x80", "\xC0\xAF", "\xED\xA0\x80", "\xFF"};
+    static const size_t widths[] = {15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 128, 129};
+    auto pick = [&](size_t n) { return static_cast<size_t>(rng() % n); };
+
+    size_t length;
+    switch (pick(4)) {
+    case 0:  length = pick(8); break;                                         // tiny and empty
+    case 1:  length = widths[pick(std::size(widths))] + pick(3) - 1; break;   // around a vector width
+    case 2:  length = pick(300); break;
+    default: length = pick(5000); break;
+    }
+
+    std::string text;
+    const unsigned style = static_cast<unsigned>(pick(5));
+    while (text.size() < length) {
+        switch (style == 4 ? pick(4) : style) {
+        case 0: text += static_cast<char>(pick(2) ? 'a' + pick(26) : 'A' + pick(26)); break;
+        case 1: text += spaces[pick(spaces.size())]; break;
+        case 2: text += static_cast<char>(0x80 + pick(128)); break;
+        default: text += utf8[pick(std::size(utf8))]; break;
+        }
+        if (style != 1 && pick(6) == 0) text += spaces[pick(spaces.size())];
+    }
+    text.resize(length);
+    // Whitespace exactly at block boundaries, where the kernels carry state between blocks
+    if (pick(2)) {
+        for (size_t at = 15; at < text.size(); at += 16)
+            if (pick(2)) text[at] = spaces[pick(spaces.size())];
+    }
+    return text;
+}
+
+bool startsWith(const char* arg, const char* prefix, const char*& value) {
+    size_t n = strlen(prefix);
+    if (strncmp(arg, prefix, n) != 0)
+        return false;
+    value = arg + n;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    unsigned long iterations = 10000, seed = 1;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        const char* value;
+        if (startsWith(argv[i], "--iterations=", value))
+            iterations = strtoul(value, nullptr, 10);
+        else if (startsWith(argv[i], "--seed=", value))
+            seed = strtoul(value, nullptr, 10);
+        else
+            files.push_back(argv[i]);
+    }
+
+    if (!files.empty()) {
+        for (const std::string& path : files) {
+            std::ifstream in(path, std::ios::binary);
+            if (!in) {
+                fprintf(stderr, "textformatter_fuzz: cannot open '%s'\n", path.c_str());
+                return 2;
+            }
+            std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            runOne(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
+        }
+        printf("textformatter_fuzz: %zu inputs replayed, no mismatches\n", files.size());
+        return 0;
+    }
+
+    std::mt19937 rng(static_cast<unsigned>(seed));
+    runOne(nullptr, 0);
+    for (unsigned long i = 0; i < iterations; ++i) {
+        std::string input(1, static_cast<char>(rng() & 0xFF));
+        // The large (seed >= 0xC0) variant is expensive; keep it to about one case in 64
+        if ((static_cast<unsigned char>(input[0]) & 0xC0) == 0xC0 && rng() % 16 != 0)
+            input[0] &= 0x7F;
+        input += generate(rng);
+        runOne(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    }
+    printf("textformatter_fuzz: %lu generated inputs (seed %lu), no mismatches\n", iterations, seed);
+    return 0;
+}
+#endif
@@ -0,0 +1,13 @@
+#!/bin/bash
+
+# Performance regression harness: builds the benchmark suite, then records / compares
+# throughput per commit with bench/perf_regress.py (results in perf-results/), for example:
+#   ./perf.sh check                           (record HEAD, fail if >10% slower than HEAD~1)
+#   ./perf.sh record --repetitions=9
+#   ./perf.sh compare main HEAD --threshold=0.05
+#   ./perf.sh startup ./textformatter ./textformatter_static   (per-invocation latency only)
+# record and check also track the startup latency of ./textformatter (built here) and of
+# ./textformatter_static when build-static.sh has produced it
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -Isrc bench/TextFormatterBench.cpp -lbenchmark -o textformatter_bench || exit 1
+g++ -std=c++20 -O2 -Wall -Wextra -pthread src/Pattern-Strategy-TextFormatter.cpp -o textformatter -ldl || exit 1
+python3 bench/perf_regress.py "$@"
@@ -0,0 +1,42 @@
+/*
+File:           SwapCasePlugin.cpp
+Description:    Example strategy plugin for FormatterRegistry::loadPlugin().
+                Adds a "swapcase" strategy that inverts the case of every ASCII letter.
+
+Build & use:
+                g++ -std=c++20 -O2 -fPIC -shared -Isrc plugins/SwapCasePlugin.cpp -o swapcase.so
+                ./textformatter --plugin=./swapcase.so --mode=swapcase
+
+Educational Walkthrough Notes:
+                - A plugin is an ordinary shared library built against TextFormatter.h
+                - It exports one extern "C" function, textformatter_register(), which the host calls
+                  with its registry; the plugin registers its strategies there like a built-in would
+                - The ABI version check refuses to load a plugin built against an incompatible header
+*/
+
+#include "TextFormatter.h"
+
+// Concrete Strategy: Swap Case
+// Every ASCII letter has its case bit (0x20) flipped; all other bytes pass through unchanged
+class SwapCaseFormatter final : public CaseTableFormatter {
+public:
+    const char* name() const override { return "swapcase"; }
+
+    void formatSpan(std::span<char> text) override {
+        for (char& c : text) {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (static_cast<unsigned char>((u | 0x20) - 'a') < 26)
+                c = static_cast<char>(u ^ 0x20);
+        }
+    }
+
+    // Independent per byte, so any split into chunks is safe
+    bool supportsChunking() const override { return true; }
+};
+
+extern "C" bool textformatter_register(FormatterRegistry& registry, unsigned abiVersion) {
+    if (abiVersion != FormatterRegistry::pluginAbiVersion)
+        return false;
+    registry.add<SwapCaseFormatter>("swapcase");
+    return true;
+}
@@ -1,226 +1,862 @@
-/*
-Author:         Frank Roscoe
-Origin:         Object-Oriented Analysis course assignment
-Refactored:     Extended and polished for Design Pattern Series portfolio
-Date:           10/26/2025
-Description:    Proof-of-concept demo illustrating the Strategy Design Pattern in C++.
-                Demonstrates runtime selection of text formatting algorithms (uppercase, lowercase, title case)
-                via interchangeable strategies, without modifying the context class.
-
-Educational Walkthrough Notes:
-                This project contains extensive inline comments. They are intentional:
-                - To support my own learning process as a student.
-                - To serve as a teaching aid for future students.
-                - To demonstrate not just the code, but the reasoning behind design decisions.
-                Note: This demo is intentionally comment-heavy for teaching clarity.
-                In production or recruiter-facing projects, I write leaner, concise code.
-                This version is part of my Design Pattern Series portfolio, blending education and professional practice.
-*/
-
-#include <iostream>
-#include <string>
-#include <cctype>
-#include <memory>
-using namespace std;
-
-// Strategy Interface
-// Instructional notes:
-// - This is an abstract class defining the interface for text formatting strategies
-// - It contains a pure virtual function and cannot be instantiated directly
-// - It is used to define a common interface for different text formatting algorithms (derived classes)
-// - The destructor is virtual to ensure proper cleanup of derived classes
-// - Since C++ does not have built-in interface support, this sample app uses an abstract class
-//   with pure virtual functions to achieve similar functionality
-// - The superclass starts with 'I' to indicate it's an interface, following common conventions in C# and .NET.
-//   This naming convention is not standard in C++, but is used here for clarity and cross-language teaching consistency
-// - This allows for polymorphism, enabling the context class to use different formatting strategies interchangeably
-
-class ITextFormatter {
-public:
-    // Pure virtual method that defines the formatting strategy
-    // Accepts a constant reference to a string (to avoid copying) and returns a formatted string
-    // Must be overridden by all concrete formatter classes
-    virtual string format(const string& text) = 0;
-
-    // Virtual destructor ensures proper cleanup of derived objects
-    // when deleted through a base class pointer
-    virtual ~ITextFormatter() {}
-};
-
-// Concrete Strategies: derived from the Strategy Interface
-// Instructional notes:
-// - These are concrete strategy classes that implement the ITextFormatter interface
-// - Each class provides a specific text formatting algorithm
-// - They override the format method to provide their unique behavior
-// - These classes can be instantiated and used by the context class to format text in different ways
-// - This demonstrates the Strategy Design Pattern, allowing the behavior of text formatting to be selected at runtime
-// - Each concrete strategy class focuses on a single responsibility, adhering to the Single Responsibility Principle
-// - New formatting strategies can be added easily without modifying existing code, following the Open/Closed Principle
-
-// Concrete Strategy: Uppercase
-// UpperCaseFormatter is a concrete strategy that implements the ITextFormatter interface
-// It transforms the input string by converting all characters to uppercase
-class UpperCaseFormatter : public ITextFormatter {
-public:
-    // Overrides the format method from the Interface superclass to apply uppercase transformation
-    // Iterates through each character in the input string and converts it to uppercase
-    string format(const string& text) override {
-        string result = text;
-        // Using range-based for loop to iterate through each character of the 'result' string
-        // Chars are accessed by reference to modify them directly in-place to uppercase
-        for (char& c : result) c = toupper(c);
-        return result;
-    }
-};
-
-// Concrete Strategy: Lowercase
-// LowerCaseFormatter is a concrete strategy that implements the ITextFormatter interface
-// It transforms the input string by converting all characters to lowercase
-class LowerCaseFormatter : public ITextFormatter {
-public:
-    // Overrides the format method from the Interface superclass to apply lowercase transformation
-    // Iterates through each character in the input string and converts it to lowercase
-    string format(const string& text) override {
-        string result = text;
-        // Using range-based for loop to iterate through each character of the 'result' string
-        // Chars are accessed by reference to modify them directly in-place to lowercase
-        for (char& c : result) c = tolower(c);
-        return result;
-    }
-};
-
-// Concrete Strategy: Title Case
-// TitleCaseFormatter is a concrete strategy that implements the ITextFormatter interface
-// It transforms the input string by capitalizing the first letter of each word
-class TitleCaseFormatter : public ITextFormatter {
-public:
-    string format(const string& text) override {
-        string result = text;
-        bool capitalize = true;
-
-        // Using range-based for loop to iterate through each character of the 'result' string
-        // The 'capitalize' flag tracks whether the current character is the start of a word
-        for (char& c : result) {
-            if (isspace(c)) {
-                capitalize = true; // Next non-space character starts a new word
-            }
-            else if (capitalize) {
-                c = toupper(c);    // Capitalize first letter of the word
-                capitalize = false;
-            }
-            else {
-                c = tolower(c);    // Lowercase the rest of the word
-            }
-        }
-        return result;
-    }
-};
-
-// Context Class: manages and applies a selected formatting strategy
-// Educational Walkthrough Notes:
-// - This class holds a smart pointer (unique_ptr) to the ITextFormatter interface
-// - Using unique_ptr expresses exclusive ownership: TextProcessor owns the strategy object
-// - Delegates formatting behavior to the currently assigned strategy object
-// - The strategy can be changed dynamically at runtime using setFormatter()
-// - Demonstrates the Strategy Design Pattern by decoupling formatting logic from the context
-// - The context class does not implement formatting itself; it provides the environment in which a strategy operates
-// - Supports scalability and flexibility: new strategies can be added without modifying the context
-// - Adheres to the Open/Closed Principle (open to extension, closed to modification)
-// - Uses composition (holding a strategy object) rather than inheritance, which increases flexibility
-// - Modern C++ note: smart pointers eliminate the need for manual memory management and prevent leaks
-
-class TextProcessor {
-private:
-    // Smart pointer to the current formatting strategy (implements ITextFormatter interface)
-    // unique_ptr ensures exclusive ownership: only one TextProcessor can own a given strategy
-    // When the TextProcessor object is destroyed or a new strategy is assigned, the old strategy
-    // is automatically cleaned up
-    unique_ptr<ITextFormatter> formatter;
-
-public:
-    // Constructor initializes the formatter smart pointer to nullptr (no strategy assigned by default)
-    // unique_ptr can safely hold nullptr, representing 'no current strategy'
-    TextProcessor() : formatter(nullptr) {}
-
-    // Assigns a new formatting strategy at runtime
-    // Ownership of the strategy object is transferred into the context using std::move
-    // This enables dynamic selection of behavior without modifying the context class
-    void setFormatter(unique_ptr<ITextFormatter> f) {
-        formatter = move(f);
-    }
-
-    // Applies the currently assigned formatting strategy to the input text
-    // If no strategy is set (formatter == nullptr), returns the original input unchanged
-    // Educational note:
-    // - 'formatter' is a unique_ptr<ITextFormatter> initialized to nullptr in the constructor
-    // - It is set explicitly via the public setFormatter() method, so assignment happens outside the class (in main())
-    // - Smart pointer semantics ensure safe cleanup when strategies are replaced or when TextProcessor goes out of scope
-    string format(const string& text) {
-        if (formatter)
-            return formatter->format(text);
-        else
-            return text;
-    }
-};
-
-// Main Function
-int main() {
-    // Create a TextProcessor object (context class)
-    // This will be used to apply a selected text formatting strategy
-    TextProcessor processor;
-    string input;
-
-    // Prompt the user to enter a sentence to be formatted
-    cout << "Enter a sentence: ";
-    // Read full line including spaces
-    getline(cin, input);
-
-    // Present formatting options to the user
-    cout << "\nChoose a format:\n";
-    cout << "1) Uppercase\n";
-    cout << "2) Lowercase\n";
-    cout << "3) Title Case\n";
-    cout << "Enter choice (1-3): ";
-
-    int choice;
-    // Read user's formatting choice
-    cin >> choice;
-
-    // Based on user's choice, assign the appropriate concrete strategy to the context
-    // Educational Walkthrough Notes:
-    // - Each branch creates a new concrete strategy object using std::make_unique
-    // - std::make_unique constructs the object and wraps it in a unique_ptr, ensuring safe ownership
-    // - Ownership of the strategy is transferred into the TextProcessor via setFormatter()
-    // - This demonstrates runtime flexibility: the context can switch strategies without modification
-    // - Smart pointer semantics guarantee automatic cleanup when the strategy is replaced or goes out of scope
-    switch (choice) {
-    case 1:
-        // Assign UpperCaseFormatter strategy
-        // make_unique<UpperCaseFormatter>() creates a new UpperCaseFormatter and transfers ownership
-        processor.setFormatter(make_unique<UpperCaseFormatter>());
-        break;
-    case 2:
-        // Assign LowerCaseFormatter strategy
-        // Ownership of the LowerCaseFormatter is safely moved into the context
-        processor.setFormatter(make_unique<LowerCaseFormatter>());
-        break;
-    case 3:
-        // Assign TitleCaseFormatter strategy
-        // Demonstrates polymorphism: the context interacts with ITextFormatter, not the concrete class
-        processor.setFormatter(make_unique<TitleCaseFormatter>());
-        break;
-    default:
-        // If input is invalid, no strategy is assigned
-        // The context remains with a nullptr strategy, so the original input is returned unchanged
-        cout << "Invalid choice. Using default (no formatting).\n";
-        break;
-    }
-
-    // Apply the selected formatting strategy to the input text
-    // If no strategy was set, the original input is returned unchanged
-    cout << "\nFormatted output:\n";
-    cout << processor.format(input) << "\n";
-
-    // Exit program
-    return 0;
-}
+/*
+Author:         Frank Roscoe
+Origin:         Object-Oriented Analysis course assignment
+Refactored:     Extended and polished for Design Pattern Series portfolio
+Date:           10/26/2025
+Description:    Proof-of-concept demo illustrating the Strategy Design Pattern in C++.
+                Demonstrates runtime selection of text formatting algorithms (uppercase, lowercase, title case)
+                via interchangeable strategies, without modifying the context class.
+
+Educational Walkthrough Notes:
+                This project contains extensive inline comments. They are intentional:
+                - To support my own learning process as a student.
+                - To serve as a teaching aid for future students.
+                - To demonstrate not just the code, but the reasoning behind design decisions.
+                Note: This demo is intentionally comment-heavy for teaching clarity.
+                In production or recruiter-facing projects, I write leaner, concise code.
+                This version is part of my Design Pattern Series portfolio, blending education and professional practice.
+*/
+
+#include <cstdio>
+#include <cerrno>
+#include <string>
+#include <string_view>
+#include <span>
+#include <memory>
+#include <vector>
+#include <system_error>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <csignal>
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+#if defined(__linux__)
+#include <sys/epoll.h>
+#endif
+#include "TextFormatter.h"
+using namespace std;
+
+// Command-Line Modes
+// Instructional notes:
+// - --interactive runs the original demo (prompt, read a line, menu); so does a run without any
+//   argument from a terminal. Without arguments and with stdin redirected, the program prints its
+//   usage and exits instead of waiting for menu answers: scripts always say what they want
+// - --mode=<upper|lower|title|none> (the default when only other options are given) makes it a
+//   non-interactive filter: stdin -> stdout
+//   (utf8-upper, utf8-lower and utf8-title select the UTF-8 aware strategies, title-rules the
+//   headline-style title case with extra separators and lowercase stop words)
+// - --plugin=PATH (repeatable) loads a strategy library before the mode is resolved, so its
+//   strategies can be named in --mode like the built-in ones
+// - --dir=DIR --out=DIR formats every file below DIR into the same path below the output
+//   directory, batching the file I/O through io_uring where available (--io=pool forces the
+//   pread/pwrite thread-pool path, --io=uring refuses to fall back)
+// - --serve=ADDRESS and --connect=ADDRESS run the network server and its client (see Server Mode)
+// - --input=PATH / --output=PATH replace stdin / stdout; with both given, the file is formatted
+//   through memory mappings by TextProcessor::formatFile() instead of being streamed
+// - --topology switches the parallel engine to NUMA / cache-topology-aware scheduling (pinned
+//   workers, node-local chunks, first-touch output) and prints per-node throughput after a file run
+// - --gpu-threshold=BYTES sets the input size from which file runs go to the GPU backend (built
+//   with -DTEXTFORMATTER_WITH_CUDA, see TextFormatterGpu.h); 0 keeps everything on the CPU
+// - --threads=N sizes the parallel engine used by file, bulk and GPU-fallback runs (default: one
+//   thread per hardware thread); --help prints the usage to stdout
+// - Nothing here touches iostream: all output is stdio or write(2), so a short-lived invocation
+//   pays neither for the standard streams' construction nor for their locale setup (see
+//   build-static.sh for the statically linked, LTO/PGO-optimized build, and "perf.sh startup")
+// - The filter reads large blocks with read(2) and writes them back with write(2), so iostream
+//   (and its synchronization with C stdio) is never involved on this path
+// - Each block is formatted with formatChunk(), passing the last byte of the previous block,
+//   so title case behaves exactly as if the whole stream had been formatted in one piece
+
+// Printed by --help, and to stderr for an unknown argument or an argument-less piped run
+constexpr const char* usageText =
+    "usage: textformatter [--mode=upper|lower|title|none|...] [--input=PATH] [--output=PATH] [--threads=N]\n"
+    "                     [--plugin=PATH] [--serve=ADDRESS | --connect=ADDRESS]\n"
+    "                     [--dir=DIR --out=DIR [--io=auto|uring|pool]] [--topology] [--gpu-threshold=BYTES]\n"
+    "       textformatter --interactive\n"
+    "modes: upper, lower, title, utf8-upper, utf8-lower, utf8-title, title-rules, plugin strategies,\n"
+    "       or a comma-separated pipeline such as lower,title; none copies the input unchanged\n";
+
+// Size of each read(2)/write(2) block in streaming mode
+constexpr size_t streamBlockSize = 1 << 20;
+
+// Maps a --mode name to its strategy; 'known' is set to false for unrecognized names
+// "none" is a valid mode that leaves the text unformatted (a nullptr strategy)
+// Names are resolved through FormatterRegistry, so built-in and plugin strategies look the same,
+// and a single strategy is the registry's shared singleton (no allocation)
+// A comma-separated list (e.g. "lower,title") builds a CompositeFormatter pipeline, whose stages
+// are fresh objects created by the registry's factories
+shared_ptr<ITextFormatter> makeFormatter(string_view mode, bool& known) {
+    FormatterRegistry& registry = FormatterRegistry::global();
+    known = true;
+    if (mode.find(',') != string_view::npos) {
+        auto pipeline = make_unique<CompositeFormatter>();
+        while (known && !mode.empty()) {
+            size_t comma = mode.find(',');
+            string_view name = mode.substr(0, comma);
+            if (auto stage = registry.create(name))
+                pipeline->add(move(stage));
+            else
+                known = name == "none";
+            mode = comma == string_view::npos ? string_view() : mode.substr(comma + 1);
+        }
+        pipeline->useCaseTables(CaseTables::forCurrentLocale());
+        return pipeline;
+    }
+    if (auto strategy = registry.instance(mode))
+        return strategy;
+    if (mode != "none") known = false;
+    return nullptr;
+}
+
+// Reads until 'buffer' is full or end of input; returns the byte count, or -1 on error
+ptrdiff_t readBlock(int fd, span<char> buffer) {
+    size_t filled = 0;
+    while (filled < buffer.size()) {
+        auto n = ::read(fd, buffer.data() + filled, static_cast<unsigned>(buffer.size() - filled));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        filled += static_cast<size_t>(n);
+    }
+    return static_cast<ptrdiff_t>(filled);
+}
+
+// Writes the whole buffer, retrying short writes; returns false on error
+bool writeBlock(int fd, span<const char> buffer) {
+    size_t written = 0;
+    while (written < buffer.size()) {
+        auto n = ::write(fd, buffer.data() + written, static_cast<unsigned>(buffer.size() - written));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return false;
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Streams 'inFd' to 'outFd' through the processor's strategy; returns the process exit code
+int runStreamingMode(TextProcessor& processor, int inFd, int outFd) {
+    // Left uninitialized: a zero-filled vector would fault in all 256 pages of the block before
+    // the first read(2), which dominated the run time of short-lived invocations; this way only
+    // the pages a read actually fills are ever touched
+    unique_ptr<char[]> storage = make_unique_for_overwrite<char[]>(streamBlockSize);
+    span<char> buffer(storage.get(), streamBlockSize);
+
+    // Strategies that cannot be chunked need the whole input at once
+    if (!processor.supportsChunking()) {
+        string all;
+        ptrdiff_t n;
+        while ((n = readBlock(inFd, buffer)) > 0)
+            all.append(buffer.data(), static_cast<size_t>(n));
+        if (n < 0) {
+            perror("textformatter: read");
+            return 1;
+        }
+        processor.formatInPlace(all);
+        if (!writeBlock(outFd, all)) {
+            perror("textformatter: write");
+            return 1;
+        }
+        return 0;
+    }
+
+    char preceding = ' ';
+    for (;;) {
+        ptrdiff_t n = readBlock(inFd, buffer);
+        if (n < 0) {
+            perror("textformatter: read");
+            return 1;
+        }
+        if (n == 0)
+            return 0;
+        span<char> block(buffer.data(), static_cast<size_t>(n));
+        // Remember the unformatted last byte before the block is rewritten in place
+        char last = block.back();
+        processor.formatChunk(block, preceding);
+        preceding = last;
+        if (!writeBlock(outFd, block)) {
+            perror("textformatter: write");
+            return 1;
+        }
+    }
+}
+
+// Server Mode
+// Instructional notes:
+// - --serve=ADDRESS turns the program into a long-running daemon; ADDRESS is unix:PATH for a
+//   Unix domain socket or tcp:HOST:PORT (HOST may be empty to listen on every interface)
+// - The wire protocol is a compact length-prefixed binary framing; integers are little-endian
+//     request:  u8 nameLength | name | u32 bodyLength | body
+//     response: u8 status     |        u32 bodyLength | body
+//   'name' is a --mode string (a strategy, a comma-separated pipeline or "none"), so every
+//   request picks its own strategy; status 0 carries the formatted body, any other status an
+//   error message
+// - Requests are pipelined: a client may send any number of frames without waiting, and the
+//   responses come back in the same order on the same connection
+// - One thread runs an epoll(7) loop over non-blocking sockets; each connection owns a receive
+//   buffer and a send buffer, and every complete frame in the receive buffer is answered by
+//   formatting its body directly from the receive buffer into space reserved in the send buffer
+//   (formatInto(string_view, span<char>)), so no std::string is built per request
+// - Strategies are resolved through makeFormatter() once per distinct name and remembered, so
+//   the per-request cost is one map lookup keyed by a string_view into the receive buffer
+// - A connection that stops reading its responses is not read from either once its pending
+//   output exceeds serverMaxPendingOutput, which bounds the memory one client can pin
+// - epoll was chosen over io_uring because it needs no extra library and the loop is dominated
+//   by formatting, not by syscall overhead; the server is Linux-only for the same reason
+// - --connect=ADDRESS is the matching client: each line of stdin becomes one request named by
+//   --mode, all requests are pipelined on one connection, and each response is printed as a line
+
+// Largest request body the server accepts; larger frames close the connection
+constexpr uint32_t serverMaxBodySize = 64u << 20;
+// Pending response bytes at which a connection is no longer read from
+constexpr size_t serverMaxPendingOutput = 8u << 20;
+// Bytes requested from each read(2) on a connection
+constexpr size_t serverReadSize = 64u << 10;
+// Distinct strategy names remembered by the server; further names are resolved per request
+constexpr size_t serverMaxCachedStrategies = 256;
+
+// Response status codes
+enum class ServerStatus : unsigned char { ok = 0, unknownStrategy = 1, badRequest = 2 };
+
+#if defined(__linux__)
+
+// Set by SIGINT/SIGTERM; the event loop notices it when epoll_wait() is interrupted
+volatile sig_atomic_t serverStopRequested = 0;
+
+void appendLength(vector<char>& out, uint32_t n) {
+    for (int shift = 0; shift < 32; shift += 8)
+        out.push_back(static_cast<char>((n >> shift) & 0xFF));
+}
+
+uint32_t readLength(const char* p) {
+    uint32_t n = 0;
+    for (int i = 0; i < 4; ++i)
+        n |= uint32_t(static_cast<unsigned char>(p[i])) << (8 * i);
+    return n;
+}
+
+// Parses unix:PATH or tcp:HOST:PORT and creates a bound+listening (or connected) socket
+// Returns the descriptor, or -1 with an error printed; 'unixPath' receives PATH for unix: addresses
+int openSocket(string_view address, bool listening, string& unixPath) {
+    if (address.starts_with("unix:")) {
+        unixPath = address.substr(5);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (unixPath.empty() || unixPath.size() >= sizeof(addr.sun_path)) {
+            fprintf(stderr, "textformatter: bad unix socket path '%s'\n", unixPath.c_str());
+            return -1;
+        }
+        memcpy(addr.sun_path, unixPath.c_str(), unixPath.size() + 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return perror("textformatter: socket"), -1;
+        if (listening) ::unlink(unixPath.c_str());
+        int rc = listening ? ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr)
+                           : ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr);
+        if (rc < 0 || (listening && ::listen(fd, SOMAXCONN) < 0)) {
+            perror(("textformatter: " + unixPath).c_str());
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    if (address.starts_with("tcp:")) {
+        string_view hostPort = address.substr(4);
+        size_t colon = hostPort.rfind(':');
+        if (colon == string_view::npos) {
+            fprintf(stderr, "textformatter: expected tcp:HOST:PORT, got '%.*s'\n", int(address.size()), address.data());
+            return -1;
+        }
+        string host(hostPort.substr(0, colon)), port(hostPort.substr(colon + 1));
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = listening ? AI_PASSIVE : 0;
+        addrinfo* found = nullptr;
+        if (int rc = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &found); rc != 0) {
+            fprintf(stderr, "textformatter: %s: %s\n", string(hostPort).c_str(), gai_strerror(rc));
+            return -1;
+        }
+        int fd = -1;
+        for (addrinfo* ai = found; ai && fd < 0; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd < 0) continue;
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            if (listening) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+            int rc = listening ? ::bind(fd, ai->ai_addr, ai->ai_addrlen) : ::connect(fd, ai->ai_addr, ai->ai_addrlen);
+            if (rc < 0 || (listening && ::listen(fd, SOMAXCONN) < 0)) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(found);
+        if (fd < 0) perror(("textformatter: " + string(hostPort)).c_str());
+        return fd;
+    }
+    fprintf(stderr, "textformatter: expected unix:PATH or tcp:HOST:PORT, got '%.*s'\n", int(address.size()), address.data());
+    return -1;
+}
+
+// The epoll event loop and the per-connection state
+class FormatServer {
+public:
+    explicit FormatServer(int listenFd) : listenFd(listenFd), epollFd(epoll_create1(EPOLL_CLOEXEC)) {
+        if (epollFd < 0) throw system_error(errno, generic_category(), "epoll_create1");
+        watch(listenFd, EPOLLIN, EPOLL_CTL_ADD);
+    }
+
+    ~FormatServer() {
+        for (auto& [fd, connection] : connections) ::close(fd);
+        ::close(epollFd);
+    }
+
+    FormatServer(const FormatServer&) = delete;
+    FormatServer& operator=(const FormatServer&) = delete;
+
+    // Serves until SIGINT/SIGTERM; returns the process exit code
+    int run() {
+        epoll_event events[64];
+        while (!serverStopRequested) {
+            int n = epoll_wait(epollFd, events, 64, -1);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) return perror("textformatter: epoll_wait"), 1;
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) {
+                    acceptAll();
+                    continue;
+                }
+                auto it = connections.find(fd);
+                if (it == connections.end()) continue;
+                Connection& connection = it->second;
+                bool alive = true;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) alive = receive(connection);
+                if (alive && (events[i].events & EPOLLOUT)) alive = send(connection);
+                if (alive) alive = updateInterest(connection);
+                if (!alive) drop(fd);
+            }
+        }
+        return 0;
+    }
+
+private:
+    struct Connection {
+        int fd = -1;
+        vector<char> in;      // received bytes; frames start at inStart
+        size_t inStart = 0;
+        vector<char> out;     // responses; unsent bytes start at outStart
+        size_t outStart = 0;
+        uint32_t interest = EPOLLIN;
+        bool peerClosed = false;
+    };
+
+    void watch(int fd, uint32_t events, int op) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        if (epoll_ctl(epollFd, op, fd, &ev) < 0) throw system_error(errno, generic_category(), "epoll_ctl");
+    }
+
+    void acceptAll() {
+        for (;;) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) perror("textformatter: accept");
+                return;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one); // harmless failure on Unix sockets
+            connections[fd].fd = fd;
+            watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+        }
+    }
+
+    void drop(int fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        connections.erase(fd);
+    }
+
+    // Reads what is available, answers every complete frame and tries to send the answers
+    // Returns false when the connection should be closed
+    bool receive(Connection& c) {
+        while (!c.peerClosed && c.out.size() - c.outStart < serverMaxPendingOutput) {
+            size_t used = c.in.size();
+            c.in.resize(used + serverReadSize);
+            ssize_t n = ::read(c.fd, c.in.data() + used, serverReadSize);
+            c.in.resize(used + static_cast<size_t>(max<ssize_t>(n, 0)));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (n < 0) return false;
+            if (n == 0) c.peerClosed = true;
+            if (!answerFrames(c)) return false;
+        }
+        if (!send(c)) return false;
+        // A client that half-closed still gets every answer before the connection goes away
+        return !(c.peerClosed && c.outStart == c.out.size());
+    }
+
+    // Formats every complete request in c.in into c.out; returns false on a malformed frame
+    bool answerFrames(Connection& c) {
+        for (;;) {
+            const char* p = c.in.data() + c.inStart;
+            size_t available = c.in.size() - c.inStart;
+            if (available < 1) break;
+            size_t nameLength = static_cast<unsigned char>(p[0]);
+            if (available < 1 + nameLength + 4) break;
+            uint32_t bodyLength = readLength(p + 1 + nameLength);
+            if (bodyLength > serverMaxBodySize) return false;
+            size_t frameLength = 1 + nameLength + 4 + bodyLength;
+            if (available < frameLength) {
+                c.in.reserve(c.in.size() + (frameLength - available));
+                break;
+            }
+            respond(c.out, string_view(p + 1, nameLength), string_view(p + 1 + nameLength + 4, bodyLength));
+            c.inStart += frameLength;
+        }
+        // Keep the unparsed tail at the front so the buffer never grows past one partial frame
+        if (c.inStart == c.in.size()) {
+            c.in.clear();
+            c.inStart = 0;
+        }
+        else if (c.inStart > c.in.size() / 2) {
+            c.in.erase(c.in.begin(), c.in.begin() + static_cast<ptrdiff_t>(c.inStart));
+            c.inStart = 0;
+        }
+        return true;
+    }
+
+    // Appends one response frame; the formatted body is written straight into 'out'
+    void respond(vector<char>& out, string_view name, string_view body) {
+        shared_ptr<ITextFormatter> uncached;
+        bool known;
+        ITextFormatter* strategy = resolve(name, known, uncached);
+        if (!known) return respondError(out, ServerStatus::unknownStrategy, "unknown strategy");
+        // Where this response starts: a strategy that throws part-way leaves a half-written frame
+        // behind, which must be cut off again before the error frame, or the client would read
+        // the partial frame's header and lose track of every later response on the connection
+        size_t header = out.size();
+        try {
+            size_t size = strategy ? strategy->formattedSize(body) : body.size();
+            out.resize(header + 5 + size);
+            span<char> dest(out.data() + header + 5, size);
+            size_t written = size;
+            if (strategy)
+                written = strategy->formatInto(body, dest);
+            else
+                memcpy(dest.data(), body.data(), size);
+            out.resize(header + 5 + written);
+            out[header] = static_cast<char>(ServerStatus::ok);
+            for (int i = 0; i < 4; ++i)
+                out[header + 1 + i] = static_cast<char>((written >> (8 * i)) & 0xFF);
+        }
+        catch (const exception& e) {
+            out.resize(header);
+            respondError(out, ServerStatus::badRequest, e.what());
+        }
+    }
+
+    static void respondError(vector<char>& out, ServerStatus status, string_view message) {
+        out.push_back(static_cast<char>(status));
+        appendLength(out, static_cast<uint32_t>(message.size()));
+        out.insert(out.end(), message.begin(), message.end());
+    }
+
+    // Looks a strategy name up, building and remembering it the first time it is seen
+    // Unknown names are never remembered, so garbage names cannot grow the table
+    ITextFormatter* resolve(string_view name, bool& known, shared_ptr<ITextFormatter>& uncached) {
+        known = true;
+        if (auto it = strategies.find(name); it != strategies.end()) return it->second.get();
+        shared_ptr<ITextFormatter> strategy = makeFormatter(name, known);
+        if (!known) return nullptr;
+        ITextFormatter* raw = strategy.get();
+        if (strategies.size() < serverMaxCachedStrategies)
+            strategies.emplace(string(name), move(strategy));
+        else
+            uncached = move(strategy);
+        return raw;
+    }
+
+    // Writes pending output; returns false if the peer is gone
+    bool send(Connection& c) {
+        while (c.outStart < c.out.size()) {
+            ssize_t n = ::send(c.fd, c.out.data() + c.outStart, c.out.size() - c.outStart, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (n < 0) return false;
+            c.outStart += static_cast<size_t>(n);
+        }
+        if (c.outStart == c.out.size()) {
+            c.out.clear();
+            c.outStart = 0;
+        }
+        return true;
+    }
+
+    // Reads while the backlog of answers is small; waits for writability while answers are pending
+    // Returns false when the connection should be closed
+    bool updateInterest(Connection& c) {
+        size_t pending = c.out.size() - c.outStart;
+        uint32_t interest = (!c.peerClosed && pending < serverMaxPendingOutput ? EPOLLIN : 0u) | (pending ? EPOLLOUT : 0u);
+        if (interest != c.interest) {
+            watch(c.fd, interest, EPOLL_CTL_MOD);
+            c.interest = interest;
+        }
+        return true;
+    }
+
+    int listenFd;
+    int epollFd;
+    unordered_map<int, Connection> connections;
+    map<string, shared_ptr<ITextFormatter>, less<>> strategies;
+};
+
+// --serve=ADDRESS: runs the daemon until SIGINT/SIGTERM; returns the process exit code
+int runServerMode(string_view address) {
+    string unixPath;
+    int listenFd = openSocket(address, true, unixPath);
+    if (listenFd < 0) return 1;
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+
+    // No SA_RESTART: the signal must interrupt epoll_wait() so the loop can see the flag
+    struct sigaction stop{};
+    stop.sa_handler = [](int) { serverStopRequested = 1; };
+    sigemptyset(&stop.sa_mask);
+    sigaction(SIGINT, &stop, nullptr);
+    sigaction(SIGTERM, &stop, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    int status;
+    try {
+        FormatServer server(listenFd);
+        status = server.run();
+    }
+    catch (const system_error& e) {
+        fprintf(stderr, "textformatter: %s\n", e.what());
+        status = 1;
+    }
+    ::close(listenFd);
+    if (!unixPath.empty()) ::unlink(unixPath.c_str());
+    return status;
+}
+
+// --connect=ADDRESS: sends each line of 'inFd' as one request named 'mode', pipelined on a
+// single connection, and writes each answer as a line to 'outFd'; returns the process exit code
+int runClientMode(string_view address, string_view mode, int inFd, int outFd) {
+    if (mode.size() > 255) {
+        fprintf(stderr, "textformatter: strategy name longer than 255 bytes\n");
+        return 2;
+    }
+    string input;
+    vector<char> block(streamBlockSize);
+    ptrdiff_t got;
+    while ((got = readBlock(inFd, block)) > 0)
+        input.append(block.data(), static_cast<size_t>(got));
+    if (got < 0) return perror("textformatter: read"), 1;
+
+    vector<char> requests;
+    size_t requestCount = 0;
+    for (size_t start = 0; start < input.size(); ++requestCount) {
+        size_t end = min(input.find('\n', start), input.size());
+        if (end - start > serverMaxBodySize) {
+            fprintf(stderr, "textformatter: line longer than the server's body limit\n");
+            return 1;
+        }
+        requests.push_back(static_cast<char>(mode.size()));
+        requests.insert(requests.end(), mode.begin(), mode.end());
+        appendLength(requests, static_cast<uint32_t>(end - start));
+        requests.insert(requests.end(), input.begin() + static_cast<ptrdiff_t>(start), input.begin() + static_cast<ptrdiff_t>(end));
+        start = end + 1;
+    }
+
+    string unixPath;
+    int fd = openSocket(address, false, unixPath);
+    if (fd < 0) return 1;
+    signal(SIGPIPE, SIG_IGN);
+
+    // Writing and reading are interleaved with poll(2): with many requests in flight the server
+    // stops reading until its answers are consumed, so writing everything first could deadlock
+    vector<char> answers;
+    size_t sent = 0, answered = 0, parsed = 0;
+    int status = 0;
+    while (answered < requestCount) {
+        pollfd p{fd, short(POLLIN | (sent < requests.size() ? POLLOUT : 0)), 0};
+        if (poll(&p, 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("textformatter: poll");
+            status = 1;
+            break;
+        }
+        if (p.revents & POLLOUT) {
+            ssize_t n = ::send(fd, requests.data() + sent, requests.size() - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n > 0) sent += static_cast<size_t>(n);
+        }
+        if (p.revents & (POLLIN | POLLHUP | POLLERR)) {
+            size_t used = answers.size();
+            answers.resize(used + serverReadSize);
+            ssize_t n = ::recv(fd, answers.data() + used, serverReadSize, MSG_DONTWAIT);
+            answers.resize(used + static_cast<size_t>(max<ssize_t>(n, 0)));
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                fprintf(stderr, "textformatter: connection closed after %zu of %zu answers\n", answered, requestCount);
+                status = 1;
+                break;
+            }
+        }
+        while (answers.size() - parsed >= 5) {
+            uint32_t length = readLength(answers.data() + parsed + 1);
+            if (answers.size() - parsed < 5 + size_t(length)) break;
+            string_view body(answers.data() + parsed + 5, length);
+            if (static_cast<ServerStatus>(answers[parsed]) == ServerStatus::ok) {
+                if (!writeBlock(outFd, body) || !writeBlock(outFd, string_view("\n"))) {
+                    perror("textformatter: write");
+                    ::close(fd);
+                    return 1;
+                }
+            }
+            else {
+                fprintf(stderr, "textformatter: server: %.*s\n", int(body.size()), body.data());
+                status = 1;
+            }
+            parsed += 5 + length;
+            ++answered;
+        }
+        if (parsed == answers.size()) {
+            answers.clear();
+            parsed = 0;
+        }
+    }
+    ::close(fd);
+    return status;
+}
+
+#else
+
+int runServerMode(string_view) {
+    fprintf(stderr, "textformatter: server mode requires Linux (epoll)\n");
+    return 1;
+}
+
+int runClientMode(string_view, string_view, int, int) {
+    fprintf(stderr, "textformatter: client mode requires Linux\n");
+    return 1;
+}
+
+#endif
+
+// Main Function
+int main(int argc, char* argv[]) {
+    // Create a TextProcessor object (context class)
+    // This will be used to apply a selected text formatting strategy
+    TextProcessor processor;
+    string input;
+
+    // An argument-less run only prompts when someone is there to answer
+    bool interactive = argc == 1 && isatty(0);
+    if (argc == 1 && !interactive) {
+        fputs(usageText, stderr);
+        return 2;
+    }
+    if (argc == 2 && string_view(argv[1]) == "--interactive")
+        interactive = true;
+    if (argc == 2 && (string_view(argv[1]) == "--help" || string_view(argv[1]) == "-h")) {
+        fputs(usageText, stdout);
+        return 0;
+    }
+
+    // Non-interactive modes: textformatter --mode=<upper|lower|title|none> [--input=PATH] [--output=PATH] [--plugin=PATH]
+    if (!interactive) {
+        string_view mode = "none";
+        string inputPath, outputPath, pluginPath, serveAddress, connectAddress, inputDir, outputDir;
+        string_view ioBackend = "auto";
+        vector<string> plugins;
+        bool topologyReport = false;
+        string_view gpuThreshold, threads;
+        for (int i = 1; i < argc; ++i) {
+            string_view arg = argv[i];
+            if (arg == "--interactive" || arg == "--help" || arg == "-h") {
+                fprintf(stderr, "textformatter: %s takes no other arguments\n", argv[i]);
+                return 2;
+            }
+            if (arg == "--topology") {
+                processor.setTopologyAware(true);
+                topologyReport = true;
+                continue;
+            }
+            auto option = [&](string_view name, auto& value) {
+                if (arg.starts_with(name) && arg.size() > name.size() && arg[name.size()] == '=') {
+                    value = arg.substr(name.size() + 1);
+                    return true;
+                }
+                if (arg == name && i + 1 < argc) {
+                    value = argv[++i];
+                    return true;
+                }
+                return false;
+            };
+            if (option("--plugin", pluginPath)) {
+                plugins.push_back(pluginPath);
+                continue;
+            }
+            if (!option("--mode", mode) && !option("--input", inputPath) && !option("--output", outputPath)
+                && !option("--serve", serveAddress) && !option("--connect", connectAddress)
+                && !option("--dir", inputDir) && !option("--out", outputDir) && !option("--io", ioBackend)
+                && !option("--gpu-threshold", gpuThreshold) && !option("--threads", threads)) {
+                fprintf(stderr, "textformatter: unknown argument '%s'\n%s", argv[i], usageText);
+                return 2;
+            }
+        }
+        // Whole-string decimal parse (from_chars: no locale, no exceptions)
+        auto number = [](string_view text, auto& value) {
+            auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+            return error == errc() && end == text.data() + text.size();
+        };
+        if (!gpuThreshold.empty()) {
+            size_t threshold = 0;
+            if (!number(gpuThreshold, threshold)) {
+                fprintf(stderr, "textformatter: --gpu-threshold needs a byte count\n");
+                return 2;
+            }
+            processor.setGpuOffload(threshold);
+        }
+        if (!threads.empty()) {
+            unsigned count = 0;
+            if (!number(threads, count) || count == 0) {
+                fprintf(stderr, "textformatter: --threads needs a positive thread count\n");
+                return 2;
+            }
+            processor.setThreadCount(count);
+        }
+        for (const string& path : plugins) {
+            try {
+                FormatterRegistry::global().loadPlugin(path);
+            }
+            catch (const exception& e) {
+                fprintf(stderr, "textformatter: %s\n", e.what());
+                return 1;
+            }
+        }
+        if (!serveAddress.empty())
+            return runServerMode(serveAddress);
+
+        // With --connect the server resolves the mode (it may have plugins this process lacks)
+        bool known = true;
+        if (connectAddress.empty())
+            processor.shareFormatter(makeFormatter(mode, known));
+        if (!known) {
+            fprintf(stderr, "textformatter: unknown mode '%.*s'\n", int(mode.size()), mode.data());
+            return 2;
+        }
+
+        if (!inputDir.empty() || !outputDir.empty()) {
+            static constexpr pair<string_view, BulkBackend> backends[] = {
+                {"auto", BulkBackend::automatic}, {"uring", BulkBackend::ioUring}, {"pool", BulkBackend::threadPool}};
+            auto backend = find_if(begin(backends), end(backends), [&](const auto& b) { return b.first == ioBackend; });
+            if (inputDir.empty() || outputDir.empty() || backend == end(backends)) {
+                fprintf(stderr, "textformatter: bulk mode needs --dir=DIR --out=DIR and --io=auto|uring|pool\n");
+                return 2;
+            }
+            try {
+                processor.formatDirectory(inputDir, outputDir, backend->second);
+            }
+            catch (const system_error& e) {
+                fprintf(stderr, "textformatter: %s\n", e.what());
+                return 1;
+            }
+            return 0;
+        }
+
+        if (connectAddress.empty() && !inputPath.empty() && !outputPath.empty()) {
+            try {
+                processor.formatFile(inputPath, outputPath);
+            }
+            catch (const system_error& e) {
+                fprintf(stderr, "textformatter: %s\n", e.what());
+                return 1;
+            }
+            // Per-node report of the topology-aware split (files too small to split have none)
+            if (topologyReport) {
+                for (const topology::NodeThroughput& node : processor.nodeThroughput())
+                    fprintf(stderr, "textformatter: node %u: %u workers, %zu bytes in %.3f ms (%.2f GB/s), %zu bytes remote\n",
+                            node.node, node.workers, node.bytes, node.seconds * 1e3, node.bytesPerSecond() / 1e9,
+                            node.remoteBytes);
+            }
+            return 0;
+        }
+
+        int inFd = 0, outFd = 1;
+        if (!inputPath.empty() && (inFd = open(inputPath.c_str(), O_RDONLY)) < 0) {
+            perror(("textformatter: " + inputPath).c_str());
+            return 1;
+        }
+        if (!outputPath.empty() && (outFd = open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+            perror(("textformatter: " + outputPath).c_str());
+            return 1;
+        }
+        if (!connectAddress.empty())
+            return runClientMode(connectAddress, mode, inFd, outFd);
+        return runStreamingMode(processor, inFd, outFd);
+    }
+
+    // Prompt the user to enter a sentence to be formatted
+    // The demo uses C stdio like the rest of the program (no iostream in this binary at all)
+    fputs("Enter a sentence: ", stdout);
+    fflush(stdout);
+    // Read full line including spaces (byte by byte, so embedded NUL bytes survive)
+    for (int c; (c = getchar()) != EOF && c != '\n';)
+        input.push_back(static_cast<char>(c));
+
+    // Present formatting options to the user
+    fputs("\nChoose a format:\n"
+          "1) Uppercase\n"
+          "2) Lowercase\n"
+          "3) Title Case\n"
+          "Enter choice (1-3): ", stdout);
+    fflush(stdout);
+
+    // Read user's formatting choice; no number (e.g. an empty line at end of input) leaves 0
+    int choice = 0;
+    if (scanf("%d", &choice) != 1)
+        choice = 0;
+
+    // Based on user's choice, assign the appropriate concrete strategy to the context
+    // Educational Walkthrough Notes:
+    // - The menu numbers map to strategy names, and the names are looked up in the FormatterRegistry
+    // - The registry created each stateless strategy once; instance() hands out that shared object,
+    //   so choosing a strategy costs a lookup instead of a new heap allocation
+    // - Ownership is shared with the registry via shared_ptr, and shareFormatter() stores it in the context
+    // - This demonstrates runtime flexibility: the context can switch strategies without modification,
+    //   and a strategy added to the registry (even from a plugin) needs no new case here
+    static constexpr string_view menu[] = {"upper", "lower", "title"};
+    if (choice >= 1 && choice <= 3) {
+        processor.shareFormatter(FormatterRegistry::global().instance(menu[choice - 1]));
+    }
+    else {
+        // If input is invalid, no strategy is assigned
+        // The context remains with a nullptr strategy, so the original input is returned unchanged
+        fputs("Invalid choice. Using default (no formatting).\n", stdout);
+    }
+
+    // Apply the selected formatting strategy to the input text
+    // If no strategy was set, the original input is returned unchanged
+    string output = processor.format(input);
+    fputs("\nFormatted output:\n", stdout);
+    fwrite(output.data(), 1, output.size(), stdout);
+    fputc('\n', stdout);
+
+    // Exit program
+    return 0;
+}
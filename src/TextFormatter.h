@@ -0,0 +1,4803 @@
+/*
+File:           TextFormatter.h
+Description:    Strategy Design Pattern library: the ITextFormatter interface, the concrete
+                uppercase / lowercase / title case strategies, and the TextProcessor context.
+                Header-only, so the demo program, the benchmarks and any other tool can share it.
+
+Educational Walkthrough Notes:
+                The classes below were originally written in the single demo source file; they live
+                here so that more than one translation unit can use them.
+                Everything is spelled with an explicit std:: prefix: a 'using namespace std;' in a
+                header would leak into every file that includes it.
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <limits>
+#include <cerrno>
+#include <string>
+#include <string_view>
+#include <span>
+#include <cctype>
+#include <clocale>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <vector>
+#include <unordered_map>
+#include <deque>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
+#include <variant>
+#include <concepts>
+#include <type_traits>
+#include <bit>
+#include <ranges>
+#include <exception>
+#include <coroutine>
+#include <future>
+#include <stop_token>
+#include <typeinfo>
+#include <chrono>
+#include <system_error>
+#include <filesystem>
+#if defined(__SSE2__) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dlfcn.h>
+#endif
+#if defined(TEXTFORMATTER_WITH_ARROW)
+#include <arrow/api.h>
+#endif
+#include "TextFormatterGpu.h"
+#if defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#endif
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+// Batch Result: many formatted strings packed into one buffer
+// Instructional notes:
+// - Instead of N separate std::string objects (N heap allocations), every result is appended to a
+//   single 'data' buffer, and 'offsets' records where each one starts (the Apache Arrow layout)
+// - offsets always holds count + 1 entries: string i occupies data[offsets[i], offsets[i + 1])
+// - Calling clear() keeps both buffers' capacity, so a reused FormattedBatch stops allocating
+struct FormattedBatch {
+    std::string data;
+    std::vector<size_t> offsets{0};
+
+    size_t size() const { return offsets.size() - 1; }
+
+    std::string_view operator[](size_t i) const {
+        return std::string_view(data).substr(offsets[i], offsets[i + 1] - offsets[i]);
+    }
+
+    // Mutable view of string i, used by strategies to format each packed segment in place
+    std::span<char> segment(size_t i) {
+        return std::span<char>(data).subspan(offsets[i], offsets[i + 1] - offsets[i]);
+    }
+
+    void clear() {
+        data.clear();
+        offsets.assign(1, 0);
+    }
+
+    // Copies the inputs back to back into 'data' and fills in 'offsets'
+    void pack(std::span<const std::string_view> inputs) {
+        size_t total = 0;
+        for (std::string_view s : inputs) total += s.size();
+        clear();
+        data.reserve(total);
+        offsets.reserve(inputs.size() + 1);
+        for (std::string_view s : inputs) {
+            data.append(s);
+            offsets.push_back(data.size());
+        }
+    }
+};
+
+// Character Tables: 256-entry lookup maps for the byte-oriented strategies
+// Instructional notes:
+// - toupper()/tolower()/isspace() look the current C locale up on every call (through
+//   __ctype_toupper_loc() and friends in glibc), which costs a call per byte on the scalar path
+// - A CaseTables object captures the same answers once: upper[b], lower[b] and space[b] for all
+//   256 byte values, so the per-byte work becomes one indexed load with no function call
+// - asciiCaseTables is generated at compile time (constexpr) and describes the "C" locale; it is
+//   what every strategy uses until it is bound to other tables
+// - CaseTables::forCurrentLocale() builds the tables of whatever LC_CTYPE locale is active; the
+//   context calls it once in setFormatter(), never per character
+// - 'ascii' records that the tables are exactly the "C" ones, which is what lets the strategies
+//   take the vectorized bit-flip kernels below instead of the table loop
+struct CaseTables {
+    unsigned char upper[256];
+    unsigned char lower[256];
+    bool space[256];
+    bool ascii;
+
+    static std::shared_ptr<const CaseTables> forCurrentLocale();
+};
+
+constexpr CaseTables makeAsciiCaseTables() {
+    CaseTables t{};
+    for (int b = 0; b < 256; ++b) {
+        t.upper[b] = static_cast<unsigned char>(b >= 'a' && b <= 'z' ? b - 0x20 : b);
+        t.lower[b] = static_cast<unsigned char>(b >= 'A' && b <= 'Z' ? b + 0x20 : b);
+        t.space[b] = b == ' ' || (b >= '\t' && b <= '\r');
+    }
+    t.ascii = true;
+    return t;
+}
+
+inline constexpr CaseTables asciiCaseTables = makeAsciiCaseTables();
+
+// Snapshot of the active LC_CTYPE locale (768 libc calls, once)
+// Locales that agree with "C" on every byte share the static ASCII tables, so the common case
+// allocates nothing and keeps the SIMD fast paths
+inline std::shared_ptr<const CaseTables> CaseTables::forCurrentLocale() {
+    // Filled on the stack first: only a locale that differs from "C" pays for a heap copy
+    CaseTables tables{};
+    for (int b = 0; b < 256; ++b) {
+        tables.upper[b] = static_cast<unsigned char>(toupper(b));
+        tables.lower[b] = static_cast<unsigned char>(tolower(b));
+        tables.space[b] = isspace(b) != 0;
+    }
+    if (std::equal(std::begin(tables.upper), std::end(tables.upper), asciiCaseTables.upper)
+        && std::equal(std::begin(tables.lower), std::end(tables.lower), asciiCaseTables.lower)
+        && std::equal(std::begin(tables.space), std::end(tables.space), asciiCaseTables.space))
+        // Aliasing constructor: points at the static tables without owning them
+        return std::shared_ptr<const CaseTables>(std::shared_ptr<const CaseTables>(), &asciiCaseTables);
+    tables.ascii = false;
+    return std::make_shared<const CaseTables>(tables);
+}
+
+// Strategy Interface
+// Instructional notes:
+// - This is an abstract class defining the interface for text formatting strategies
+// - It contains a pure virtual function and cannot be instantiated directly
+// - It is used to define a common interface for different text formatting algorithms (derived classes)
+// - The destructor is virtual to ensure proper cleanup of derived classes
+// - Since C++ does not have built-in interface support, this sample app uses an abstract class
+//   with pure virtual functions to achieve similar functionality
+// - The superclass starts with 'I' to indicate it's an interface, following common conventions in C# and .NET.
+//   This naming convention is not standard in C++, but is used here for clarity and cross-language teaching consistency
+// - This allows for polymorphism, enabling the context class to use different formatting strategies interchangeably
+
+class ITextFormatter {
+public:
+    // Pure virtual method that defines the formatting strategy
+    // Rewrites the characters of 'text' in place; the buffer is owned by the caller
+    // Must be overridden by all concrete formatter classes
+    // Educational note:
+    // - Every other entry point below is built on top of this single kernel, so a concrete
+    //   strategy only has to describe *how* to transform characters, never who owns the memory
+    // - std::span<char> is a non-owning (pointer, length) view, so it can wrap a std::string,
+    //   a stack array, or a caller-owned output buffer without any allocation
+    virtual void formatSpan(std::span<char> text) = 0;
+
+    // Copying entry point: accepts a constant reference to a string (to avoid copying the
+    // argument) and returns a freshly formatted string
+    // Costs one allocation and copy per call; prefer the overloads below on hot paths
+    virtual std::string format(const std::string& text) {
+        std::string result = text;
+        formatSpan(result);
+        return result;
+    }
+
+    // Rvalue entry point: takes ownership of a temporary and reuses its storage
+    // No allocation happens (for length-preserving strategies); the moved-in buffer is
+    // formatted and moved back out
+    std::string format(std::string&& text) {
+        formatInPlace(text);
+        return std::move(text);
+    }
+
+    // In-place entry point: formats the caller's string directly
+    virtual void formatInPlace(std::string& text) {
+        formatSpan(text);
+    }
+
+    // Caller-buffer entry point: formats 'text' into 'out', reusing out's existing capacity
+    // In a steady-state loop 'out' stops growing after the first few calls, so no allocations occur
+    virtual void formatInto(std::string_view text, std::string& out) {
+        out.assign(text);
+        formatSpan(out);
+    }
+
+    // Caller-buffer entry point for raw memory: writes the formatted text into 'out'
+    // and returns the number of characters written (formattedSize(text))
+    // Throws std::length_error if 'out' is too small to hold the result
+    virtual size_t formatInto(std::string_view text, std::span<char> out) {
+        if (out.size() < text.size())
+            throw std::length_error("ITextFormatter::formatInto: output buffer too small");
+        std::span<char> dest = out.first(text.size());
+        text.copy(dest.data(), dest.size());
+        formatSpan(dest);
+        return dest.size();
+    }
+
+    // Length-changing strategies
+    // Educational note:
+    // - Every strategy so far writes exactly one output byte per input byte, which is what lets
+    //   formatSpan() work in place on a fixed-size buffer
+    // - Some mappings change the byte length (UTF-8 'ß' uppercases to "SS", 'İ' lowercases to 'i'),
+    //   so a strategy can report isLengthPreserving() == false and formattedSize() for a given input
+    // - For such strategies formatSpan() only succeeds when the text happens to keep its length;
+    //   the std::string overloads and formatInto() always work, and the engines route through them
+    virtual bool isLengthPreserving() const { return true; }
+
+    virtual size_t formattedSize(std::string_view text) { return text.size(); }
+
+    // Batch entry point: formats every input into one packed FormattedBatch
+    // Packs the inputs, then hands all segments to formatSegments() in a single virtual call
+    // Length-changing strategies are sized first and then written straight into the packed buffer
+    void formatBatch(std::span<const std::string_view> inputs, FormattedBatch& out) {
+        if (isLengthPreserving()) {
+            out.pack(inputs);
+            formatSegments(out, 0, out.size());
+            return;
+        }
+        out.clear();
+        out.offsets.reserve(inputs.size() + 1);
+        for (std::string_view s : inputs) {
+            size_t start = out.data.size();
+            out.data.resize(start + formattedSize(s));
+            formatInto(s, std::span<char>(out.data).subspan(start));
+            out.offsets.push_back(out.data.size());
+        }
+    }
+
+    // Allocator-aware entry points
+    // Educational note:
+    // - format() returns a std::string, so every result longer than the small-string buffer costs
+    //   a malloc/free pair, and under many threads those calls contend on the allocator
+    // - formatPmr() allocates its result from a caller-chosen std::pmr::memory_resource instead
+    //   (a monotonic arena for one request, an unsynchronized pool per thread, ...)
+    // - formatView() goes one step further: the bytes are placed directly in the arena and only a
+    //   string_view is returned, so nothing is destroyed per result; calling release() on a
+    //   std::pmr::monotonic_buffer_resource frees a whole request's worth of output at once
+    // - Both are sized with formattedSize() and written with formatInto(), so length-changing
+    //   strategies work unchanged
+    std::pmr::string formatPmr(std::string_view text, std::pmr::memory_resource* resource) {
+        std::pmr::string result(resource);
+        result.resize(formattedSize(text));
+        result.resize(formatInto(text, std::span<char>(result)));
+        return result;
+    }
+
+    // The view stays valid until the resource releases its memory
+    std::string_view formatView(std::string_view text, std::pmr::memory_resource& arena) {
+        size_t size = formattedSize(text);
+        if (size == 0)
+            return {};
+        char* data = static_cast<char*>(arena.allocate(size, alignof(char)));
+        return std::string_view(data, formatInto(text, std::span<char>(data, size)));
+    }
+
+    // Formats the already-packed segments [first, last) of 'batch' in place
+    // The default formats each segment through formatSpan(); concrete strategies override it
+    // to run their whole loop inside this one call (and the parallel engine calls it per slice)
+    virtual void formatSegments(FormattedBatch& batch, size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i)
+            formatSpan(batch.segment(i));
+    }
+
+    // Chunking support for the parallel and streaming engines
+    // Educational note:
+    // - A large buffer can only be split into independently formatted chunks if the strategy
+    //   says so; any strategy whose output depends on more than the previous byte must not opt in
+    // - formatChunk() formats one chunk given the byte that preceded it in the original text
+    //   (a space at the very start, which is how "start of text" behaves for word-based rules)
+    // - The defaults are safe: chunking is off, and formatChunk() ignores the preceding byte,
+    //   which is exactly right for strategies that transform every byte on its own
+    virtual bool supportsChunking() const { return false; }
+
+    virtual void formatChunk(std::span<char> chunk, char preceding) {
+        (void)preceding;
+        formatSpan(chunk);
+    }
+
+    // One-pass copies
+    // Educational note:
+    // - Copying the input and then formatting the copy reads and writes every byte twice; a
+    //   strategy whose output has the input's length and whose every output byte depends only on
+    //   that input byte (and the one before it, as for chunking) can do both in a single pass
+    // - isBytewise() declares exactly that, and formatChunkInto() is the fused pass: it reads
+    //   'source' and writes 'dest' (source.size() bytes), given the byte that preceded 'source'
+    // - The engines call formatChunkInto() instead of memcpy() + formatChunk() whenever source and
+    //   destination differ; the ASCII kernels then also switch to streaming stores for huge buffers
+    // - The default is the two-pass form, so every strategy stays correct without overriding it
+    // - 'dest' must either be the very same buffer as 'source' or not overlap it at all
+    virtual bool isBytewise() const { return false; }
+
+    virtual void formatChunkInto(std::string_view source, std::span<char> dest, char preceding) {
+        if (dest.data() != source.data())
+            memcpy(dest.data(), source.data(), source.size());
+        formatChunk(dest, preceding);
+    }
+
+    // Binds the character tables used by byte-oriented strategies (see CaseTables above)
+    // The context calls this once per setFormatter(); strategies that do not work byte by byte,
+    // such as the UTF-8 ones, keep the default and ignore it
+    virtual void useCaseTables(std::shared_ptr<const CaseTables> tables) { (void)tables; }
+
+    // Short name used to label this strategy's metrics (see namespace metrics)
+    // The default is the compiler's type name, so plugin strategies are labeled without extra work
+    virtual const char* name() const { return typeid(*this).name(); }
+
+    // Virtual destructor ensures proper cleanup of derived objects
+    // when deleted through a base class pointer
+    virtual ~ITextFormatter() {}
+};
+
+// ASCII Case-Conversion Kernels
+// Instructional notes:
+// - toupper()/tolower() consult the C locale on every call, which stops the compiler from
+//   vectorizing the loop; for plain ASCII the mapping is just "flip bit 0x20 if the byte is a letter"
+// - The kernels below apply that rule to 16 (SSE2/NEON), 32 (AVX2) or 64 (AVX-512BW) bytes per
+//   instruction: compare each byte against the letter range, AND the mask with 0x20, then XOR
+// - Bytes >= 0x80 never fall inside 'a'..'z' or 'A'..'Z', so UTF-8 sequences pass through untouched,
+//   which is exactly what toupper()/tolower() do under the "C" locale
+// - The widest kernel the CPU supports is picked once at runtime (CPUID dispatch); strategies bound
+//   to another locale's tables use the table loop instead, because letters above 0x7F may change there
+namespace ascii_kernels {
+
+// Which letter range gets its case bit flipped
+// Upper flips 'a'..'z' (lowercase -> uppercase); Lower flips 'A'..'Z' (uppercase -> lowercase)
+enum class CaseTarget { Upper, Lower };
+
+// Signature shared by every kernel: convert 'size' bytes read from 'src' and written to 'dst'
+// 'src' and 'dst' are either the very same buffer (in place) or do not overlap at all, so a copy
+// and its conversion are one pass: each byte is loaded once and stored once
+using KernelFn = void (*)(const char* src, char* dst, size_t size, char first);
+
+// Scalar ASCII kernel: also used for the tail bytes left over by the vector kernels
+inline void convertScalar(const char* src, char* dst, size_t size, char first) {
+    for (size_t i = 0; i < size; ++i) {
+        unsigned char c = static_cast<unsigned char>(src[i]);
+        // Unsigned subtraction folds the two range comparisons into one
+        dst[i] = static_cast<char>(static_cast<unsigned char>(c - first) < 26 ? c ^ 0x20 : c);
+    }
+}
+
+// Streaming (non-temporal) stores
+// Instructional notes:
+// - A normal store first pulls the destination line into the cache (a read for ownership), then
+//   the line lingers there, pushing out data that will be used again
+// - _mm_stream_si128 and its wider forms write a full line straight to memory instead: for a
+//   multi-GB copy whose result is not read back soon, that removes the extra read of the
+//   destination and leaves the cache to the source and to everything else
+// - They need an aligned destination and an sfence afterwards (streaming stores are weakly
+//   ordered); the Stream template parameter selects them, and the entry points below only do so
+//   for large, out-of-place conversions
+#if defined(__SSE2__)
+template<bool Stream>
+inline void store128(char* p, __m128i v) {
+    if constexpr (Stream)
+        _mm_stream_si128(reinterpret_cast<__m128i*>(p), v);
+    else
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+}
+
+template<bool Stream>
+inline void convertSse2(const char* src, char* dst, size_t size, char first) {
+    const __m128i lo = _mm_set1_epi8(static_cast<char>(first - 1));
+    const __m128i hi = _mm_set1_epi8(static_cast<char>(first + 26));
+    const __m128i flip = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        // Signed compares: high-bit bytes are negative, so they never land inside the range
+        __m128i inRange = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi));
+        store128<Stream>(dst + i, _mm_xor_si128(v, _mm_and_si128(inRange, flip)));
+    }
+    convertScalar(src + i, dst + i, size - i, first);
+}
+#endif
+
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+template<bool Stream>
+__attribute__((target("avx2")))
+inline void store256(char* p, __m256i v) {
+    if constexpr (Stream)
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(p), v);
+    else
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+}
+
+template<bool Stream>
+__attribute__((target("avx512f")))
+inline void store512(char* p, __m512i v) {
+    if constexpr (Stream)
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(p), v);
+    else
+        _mm512_storeu_si512(p, v);
+}
+
+template<bool Stream>
+__attribute__((target("avx2")))
+inline void convertAvx2(const char* src, char* dst, size_t size, char first) {
+    const __m256i lo = _mm256_set1_epi8(static_cast<char>(first - 1));
+    const __m256i hi = _mm256_set1_epi8(static_cast<char>(first + 26));
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i inRange = _mm256_and_si256(_mm256_cmpgt_epi8(v, lo), _mm256_cmpgt_epi8(hi, v));
+        store256<Stream>(dst + i, _mm256_xor_si256(v, _mm256_and_si256(inRange, flip)));
+    }
+    convertSse2<Stream>(src + i, dst + i, size - i, first);
+}
+
+template<bool Stream>
+__attribute__((target("avx512f,avx512bw")))
+inline void convertAvx512(const char* src, char* dst, size_t size, char first) {
+    const __m512i base = _mm512_set1_epi8(first);
+    const __m512i letters = _mm512_set1_epi8(25);
+    const __m512i flip = _mm512_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m512i v = _mm512_loadu_si512(src + i);
+        // AVX-512 produces a 64-bit mask register directly; XOR only the selected lanes
+        __mmask64 inRange = _mm512_cmple_epu8_mask(_mm512_sub_epi8(v, base), letters);
+        store512<Stream>(dst + i, _mm512_xor_si512(v, _mm512_maskz_mov_epi8(inRange, flip)));
+    }
+    convertAvx2<Stream>(src + i, dst + i, size - i, first);
+}
+#endif
+
+#if defined(__ARM_NEON)
+// NEON has no streaming-store intrinsic, so both instantiations use normal stores
+template<bool Stream>
+inline void convertNeon(const char* src, char* dst, size_t size, char first) {
+    const uint8x16_t base = vdupq_n_u8(static_cast<uint8_t>(first));
+    const uint8x16_t letters = vdupq_n_u8(25);
+    const uint8x16_t flip = vdupq_n_u8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(src + i));
+        uint8x16_t inRange = vcleq_u8(vsubq_u8(v, base), letters);
+        vst1q_u8(reinterpret_cast<uint8_t*>(dst + i), veorq_u8(v, vandq_u8(inRange, flip)));
+    }
+    convertScalar(src + i, dst + i, size - i, first);
+}
+#endif
+
+// CPUID dispatch: resolved on first use and cached in a function-local static
+template<bool Stream>
+inline KernelFn selectKernel() {
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw"))
+        return convertAvx512<Stream>;
+    if (__builtin_cpu_supports("avx2"))
+        return convertAvx2<Stream>;
+#endif
+#if defined(__SSE2__)
+    return convertSse2<Stream>;
+#elif defined(__ARM_NEON)
+    return convertNeon<Stream>;
+#else
+    return convertScalar;
+#endif
+}
+
+inline KernelFn activeKernel(bool stream) {
+#if defined(TEXTFORMATTER_FORCE_SCALAR)
+    (void)stream;
+    return convertScalar;
+#else
+    static const KernelFn kernel = selectKernel<false>();
+    static const KernelFn streamingKernel = selectKernel<true>();
+    return stream ? streamingKernel : kernel;
+#endif
+}
+
+// Title-case kernels
+// Instructional notes:
+// - The scalar loop carries a 'capitalize' flag from byte to byte, but that flag is really just
+//   "was the previous byte whitespace?" (since every non-space byte clears it)
+// - So each block can be handled independently: build a whitespace mask, shift it by one byte
+//   (pulling in the last byte of the previous block), and "word start" = shifted AND NOT whitespace
+// - Letters at a word start get uppercased, every other letter gets lowercased; both are one XOR with 0x20
+// - Whitespace here means the six "C" locale isspace() bytes: ' ', '\t', '\n', '\v', '\f', '\r'
+// - Each kernel takes and returns the carried 'capitalize' state, so callers can stitch blocks together
+// - Like the conversion kernels they read 'src' and write 'dst' (the same buffer when in place)
+using TitleKernelFn = bool (*)(const char* src, char* dst, size_t size, bool capitalize);
+
+inline bool titleScalar(const char* src, char* dst, size_t size, bool capitalize) {
+    for (size_t i = 0; i < size; ++i) {
+        unsigned char c = static_cast<unsigned char>(src[i]);
+        if (c == ' ' || static_cast<unsigned char>(c - '\t') < 5) {
+            dst[i] = static_cast<char>(c);
+            capitalize = true;
+            continue;
+        }
+        char first = capitalize ? 'a' : 'A';
+        dst[i] = static_cast<char>(static_cast<unsigned char>(c - first) < 26 ? c ^ 0x20 : c);
+        capitalize = false;
+    }
+    return capitalize;
+}
+
+#if defined(__SSE2__)
+template<bool Stream>
+inline bool titleSse2(const char* src, char* dst, size_t size, bool capitalize) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i ctrlLo = _mm_set1_epi8('\t' - 1);
+    const __m128i ctrlHi = _mm_set1_epi8('\r' + 1);
+    const __m128i lowerLo = _mm_set1_epi8('a' - 1);
+    const __m128i lowerHi = _mm_set1_epi8('z' + 1);
+    const __m128i upperLo = _mm_set1_epi8('A' - 1);
+    const __m128i upperHi = _mm_set1_epi8('Z' + 1);
+    const __m128i flip = _mm_set1_epi8(0x20);
+    // Whitespace mask of the previous block; only its last byte is ever read
+    __m128i prevWs = capitalize ? _mm_set1_epi8(-1) : _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, space),
+            _mm_and_si128(_mm_cmpgt_epi8(v, ctrlLo), _mm_cmplt_epi8(v, ctrlHi)));
+        __m128i start = _mm_andnot_si128(ws, _mm_or_si128(_mm_slli_si128(ws, 1), _mm_srli_si128(prevWs, 15)));
+        __m128i isLower = _mm_and_si128(_mm_cmpgt_epi8(v, lowerLo), _mm_cmplt_epi8(v, lowerHi));
+        __m128i isUpper = _mm_and_si128(_mm_cmpgt_epi8(v, upperLo), _mm_cmplt_epi8(v, upperHi));
+        __m128i toggle = _mm_or_si128(_mm_and_si128(start, isLower), _mm_andnot_si128(start, isUpper));
+        store128<Stream>(dst + i, _mm_xor_si128(v, _mm_and_si128(toggle, flip)));
+        prevWs = ws;
+    }
+    if (i > 0)
+        capitalize = (_mm_movemask_epi8(prevWs) & 0x8000) != 0;
+    return titleScalar(src + i, dst + i, size - i, capitalize);
+}
+#endif
+
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+template<bool Stream>
+__attribute__((target("avx2")))
+inline bool titleAvx2(const char* src, char* dst, size_t size, bool capitalize) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i ctrlLo = _mm256_set1_epi8('\t' - 1);
+    const __m256i ctrlHi = _mm256_set1_epi8('\r' + 1);
+    const __m256i lowerLo = _mm256_set1_epi8('a' - 1);
+    const __m256i lowerHi = _mm256_set1_epi8('z' + 1);
+    const __m256i upperLo = _mm256_set1_epi8('A' - 1);
+    const __m256i upperHi = _mm256_set1_epi8('Z' + 1);
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    __m256i prevWs = capitalize ? _mm256_set1_epi8(-1) : _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+            _mm256_and_si256(_mm256_cmpgt_epi8(v, ctrlLo), _mm256_cmpgt_epi8(ctrlHi, v)));
+        // Byte shift across the two 128-bit lanes: [prev.hi | ws.lo] feeds alignr for both lanes
+        __m256i shifted = _mm256_alignr_epi8(ws, _mm256_permute2x128_si256(ws, prevWs, 0x03), 15);
+        __m256i start = _mm256_andnot_si256(ws, shifted);
+        __m256i isLower = _mm256_and_si256(_mm256_cmpgt_epi8(v, lowerLo), _mm256_cmpgt_epi8(lowerHi, v));
+        __m256i isUpper = _mm256_and_si256(_mm256_cmpgt_epi8(v, upperLo), _mm256_cmpgt_epi8(upperHi, v));
+        __m256i toggle = _mm256_or_si256(_mm256_and_si256(start, isLower), _mm256_andnot_si256(start, isUpper));
+        store256<Stream>(dst + i, _mm256_xor_si256(v, _mm256_and_si256(toggle, flip)));
+        prevWs = ws;
+    }
+    if (i > 0)
+        capitalize = (static_cast<unsigned>(_mm256_movemask_epi8(prevWs)) >> 31) != 0;
+    return titleSse2<Stream>(src + i, dst + i, size - i, capitalize);
+}
+
+template<bool Stream>
+__attribute__((target("avx512f,avx512bw")))
+inline bool titleAvx512(const char* src, char* dst, size_t size, bool capitalize) {
+    const __m512i space = _mm512_set1_epi8(' ');
+    const __m512i ctrlBase = _mm512_set1_epi8('\t');
+    const __m512i ctrlCount = _mm512_set1_epi8(4);
+    const __m512i lowerBase = _mm512_set1_epi8('a');
+    const __m512i upperBase = _mm512_set1_epi8('A');
+    const __m512i letters = _mm512_set1_epi8(25);
+    const __m512i flip = _mm512_set1_epi8(0x20);
+    // With 64-bit mask registers the whole word-start computation is plain integer bit math
+    uint64_t carry = capitalize ? 1 : 0;
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m512i v = _mm512_loadu_si512(src + i);
+        uint64_t ws = _mm512_cmpeq_epi8_mask(v, space)
+            | _mm512_cmple_epu8_mask(_mm512_sub_epi8(v, ctrlBase), ctrlCount);
+        uint64_t start = ~ws & ((ws << 1) | carry);
+        uint64_t isLower = _mm512_cmple_epu8_mask(_mm512_sub_epi8(v, lowerBase), letters);
+        uint64_t isUpper = _mm512_cmple_epu8_mask(_mm512_sub_epi8(v, upperBase), letters);
+        __mmask64 toggle = (start & isLower) | (~start & isUpper);
+        store512<Stream>(dst + i, _mm512_xor_si512(v, _mm512_maskz_mov_epi8(toggle, flip)));
+        carry = ws >> 63;
+    }
+    return titleAvx2<Stream>(src + i, dst + i, size - i, carry != 0);
+}
+#endif
+
+#if defined(__ARM_NEON)
+template<bool Stream>
+inline bool titleNeon(const char* src, char* dst, size_t size, bool capitalize) {
+    const uint8x16_t space = vdupq_n_u8(' ');
+    const uint8x16_t ctrlBase = vdupq_n_u8('\t');
+    const uint8x16_t ctrlCount = vdupq_n_u8(4);
+    const uint8x16_t lowerBase = vdupq_n_u8('a');
+    const uint8x16_t upperBase = vdupq_n_u8('A');
+    const uint8x16_t letters = vdupq_n_u8(25);
+    const uint8x16_t flip = vdupq_n_u8(0x20);
+    uint8x16_t prevWs = vdupq_n_u8(capitalize ? 0xFF : 0x00);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(src + i));
+        uint8x16_t ws = vorrq_u8(vceqq_u8(v, space), vcleq_u8(vsubq_u8(v, ctrlBase), ctrlCount));
+        uint8x16_t start = vbicq_u8(vextq_u8(prevWs, ws, 15), ws);
+        uint8x16_t isLower = vcleq_u8(vsubq_u8(v, lowerBase), letters);
+        uint8x16_t isUpper = vcleq_u8(vsubq_u8(v, upperBase), letters);
+        uint8x16_t toggle = vorrq_u8(vandq_u8(start, isLower), vbicq_u8(isUpper, start));
+        vst1q_u8(reinterpret_cast<uint8_t*>(dst + i), veorq_u8(v, vandq_u8(toggle, flip)));
+        prevWs = ws;
+    }
+    if (i > 0)
+        capitalize = vgetq_lane_u8(prevWs, 15) != 0;
+    return titleScalar(src + i, dst + i, size - i, capitalize);
+}
+#endif
+
+template<bool Stream>
+inline TitleKernelFn selectTitleKernel() {
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw"))
+        return titleAvx512<Stream>;
+    if (__builtin_cpu_supports("avx2"))
+        return titleAvx2<Stream>;
+#endif
+#if defined(__SSE2__)
+    return titleSse2<Stream>;
+#elif defined(__ARM_NEON)
+    return titleNeon<Stream>;
+#else
+    return titleScalar;
+#endif
+}
+
+inline TitleKernelFn activeTitleKernel(bool stream) {
+#if defined(TEXTFORMATTER_FORCE_SCALAR)
+    (void)stream;
+    return titleScalar;
+#else
+    static const TitleKernelFn kernel = selectTitleKernel<false>();
+    static const TitleKernelFn streamingKernel = selectTitleKernel<true>();
+    return stream ? streamingKernel : kernel;
+#endif
+}
+
+// Out-of-place conversions at least this large use streaming stores: well past any last-level
+// cache, where the destination would only evict the source on its way through
+inline constexpr size_t nonTemporalThreshold = 8u << 20;
+
+// Bytes to handle with the scalar loop before 'dst' is 64-byte aligned for streaming stores
+inline size_t streamingHead(const char* dst, size_t size) {
+    return std::min(size, static_cast<size_t>(-reinterpret_cast<uintptr_t>(dst) & 63));
+}
+
+// Orders the weakly-ordered streaming stores before anything the caller does next
+inline void streamingFence() {
+#if defined(__SSE2__)
+    _mm_sfence();
+#endif
+}
+
+// Entry points used by the strategies; they return false when the caller must use the table loop
+// The strategies only call them with tables that are exactly the "C" ones (CaseTables::ascii),
+// so no locale is inspected here
+// Building with -DTEXTFORMATTER_FORCE_SCALAR disables every fast path, which gives test.sh a
+// reference binary (driven by the constexpr tables) to diff the vectorized build against
+inline bool convertInto(const char* src, char* dst, size_t size, CaseTarget target) {
+#if defined(TEXTFORMATTER_FORCE_SCALAR)
+    (void)src; (void)dst; (void)size; (void)target;
+    return false;
+#else
+    char first = target == CaseTarget::Upper ? 'a' : 'A';
+    if (src != dst && size >= nonTemporalThreshold) {
+        size_t head = streamingHead(dst, size);
+        convertScalar(src, dst, head, first);
+        activeKernel(true)(src + head, dst + head, size - head, first);
+        streamingFence();
+    }
+    else {
+        activeKernel(false)(src, dst, size, first);
+    }
+    return true;
+#endif
+}
+
+inline bool convert(std::span<char> text, CaseTarget target) {
+    return convertInto(text.data(), text.data(), text.size(), target);
+}
+
+inline bool titleCaseInto(const char* src, char* dst, size_t size, bool capitalize) {
+#if defined(TEXTFORMATTER_FORCE_SCALAR)
+    (void)src; (void)dst; (void)size; (void)capitalize;
+    return false;
+#else
+    if (src != dst && size >= nonTemporalThreshold) {
+        size_t head = streamingHead(dst, size);
+        capitalize = titleScalar(src, dst, head, capitalize);
+        activeTitleKernel(true)(src + head, dst + head, size - head, capitalize);
+        streamingFence();
+    }
+    else {
+        activeTitleKernel(false)(src, dst, size, capitalize);
+    }
+    return true;
+#endif
+}
+
+inline bool titleCase(std::span<char> text, bool capitalize) {
+    return titleCaseInto(text.data(), text.data(), text.size(), capitalize);
+}
+
+} // namespace ascii_kernels
+
+// Concrete Strategies: derived from the Strategy Interface
+// Instructional notes:
+// - These are concrete strategy classes that implement the ITextFormatter interface
+// - Each class provides a specific text formatting algorithm
+// - They override the format method to provide their unique behavior
+// - These classes can be instantiated and used by the context class to format text in different ways
+// - This demonstrates the Strategy Design Pattern, allowing the behavior of text formatting to be selected at runtime
+// - Each concrete strategy class focuses on a single responsibility, adhering to the Single Responsibility Principle
+// - New formatting strategies can be added easily without modifying existing code, following the Open/Closed Principle
+// - The built-in strategies are marked 'final': a call through a concrete type can then never reach
+//   an override, so the compiler binds it statically and can inline it (see StaticTextProcessor)
+// - To add your own behaviour, derive a new strategy from ITextFormatter rather than from these classes
+
+// Table-driven base for the byte-oriented strategies
+// Holds the CaseTables the strategy formats with: the constexpr "C" tables by default, or the
+// tables of a locale once a context binds them through useCaseTables()
+// 'owner' keeps locale tables alive; the hot path only ever reads through the raw pointer
+class CaseTableFormatter : public ITextFormatter {
+protected:
+    const CaseTables* tables = &asciiCaseTables;
+    std::shared_ptr<const CaseTables> owner;
+
+public:
+    void useCaseTables(std::shared_ptr<const CaseTables> t) override {
+        tables = t ? t.get() : &asciiCaseTables;
+        owner = std::move(t);
+    }
+};
+
+// Shared base of the bytewise case strategies (upper, lower, title)
+// Instructional notes:
+// - Each of them maps every byte to exactly one byte, looking at most one byte back, so all the
+//   copying entry points are routed through their one-pass formatChunkInto()
+// - format() sizes its result without copying the input into it first; where the standard
+//   library offers resize_and_overwrite() (C++23) not even a zero fill happens
+class BytewiseCaseFormatter : public CaseTableFormatter {
+public:
+    // Overriding format(const std::string&) below would otherwise hide the rvalue overload, and
+    // format(std::move(s)) on a concrete strategy would copy instead of reusing the moved-in buffer
+    using ITextFormatter::format;
+
+    bool isBytewise() const override { return true; }
+
+    // The GPU backend's equivalent of this strategy (see TextFormatterGpu.h); it only matches the
+    // CPU result while the strategy formats with the "C" tables
+    virtual gpu::CaseOp caseOp() const = 0;
+
+    bool hasAsciiTables() const { return tables->ascii; }
+
+    bool supportsChunking() const override { return true; }
+
+    std::string format(const std::string& text) override {
+        std::string result;
+#if defined(__cpp_lib_string_resize_and_overwrite)
+        result.resize_and_overwrite(text.size(), [&](char* data, size_t size) {
+            formatChunkInto(text, std::span<char>(data, size), ' ');
+            return size;
+        });
+#else
+        result.resize(text.size());
+        formatChunkInto(text, result, ' ');
+#endif
+        return result;
+    }
+
+    void formatInto(std::string_view text, std::string& out) override {
+        out.resize(text.size());
+        formatChunkInto(text, out, ' ');
+    }
+
+    size_t formatInto(std::string_view text, std::span<char> out) override {
+        if (out.size() < text.size())
+            throw std::length_error("ITextFormatter::formatInto: output buffer too small");
+        formatChunkInto(text, out.first(text.size()), ' ');
+        return text.size();
+    }
+};
+
+// Concrete Strategy: Uppercase
+// UpperCaseFormatter is a concrete strategy that implements the ITextFormatter interface
+// It transforms the input string by converting all characters to uppercase
+class UpperCaseFormatter final : public BytewiseCaseFormatter {
+public:
+    const char* name() const override { return "upper"; }
+
+    gpu::CaseOp caseOp() const override { return gpu::CaseOp::upper; }
+
+    // Overrides the formatSpan kernel from the Interface superclass to apply uppercase transformation
+    // Iterates through each character in the caller's buffer and converts it to uppercase
+    void formatSpan(std::span<char> text) override {
+        // Fast path: vectorized ASCII kernel (only valid with the "C" tables)
+        if (tables->ascii && ascii_kernels::convert(text, ascii_kernels::CaseTarget::Upper))
+            return;
+        // Using range-based for loop to iterate through each character of the 'text' span
+        // Chars are accessed by reference and replaced in-place by their uppercase table entry
+        const unsigned char* upper = tables->upper;
+        for (char& c : text) c = static_cast<char>(upper[static_cast<unsigned char>(c)]);
+    }
+
+    // One pass from 'source' to 'dest'; every byte stands alone, so 'preceding' is not needed
+    void formatChunkInto(std::string_view source, std::span<char> dest, char) override {
+        if (tables->ascii && ascii_kernels::convertInto(source.data(), dest.data(), source.size(), ascii_kernels::CaseTarget::Upper))
+            return;
+        const unsigned char* upper = tables->upper;
+        for (size_t i = 0; i < source.size(); ++i)
+            dest[i] = static_cast<char>(upper[static_cast<unsigned char>(source[i])]);
+    }
+
+    // Lazy form: a random-access view of the uppercased bytes, computed as they are read
+    // Useful when the result is only compared, hashed or written out, e.g.
+    // std::ranges::equal(f.view(a), f.view(b)) is a case-insensitive comparison with no allocation
+    // The view refers to 'text' and to this strategy's tables, so it must not outlive either
+    auto view(std::string_view text) const {
+        const unsigned char* upper = tables->upper;
+        return text | std::views::transform([upper](char c) {
+            return static_cast<char>(upper[static_cast<unsigned char>(c)]);
+        });
+    }
+
+    // Uppercasing is independent per byte, so the packed segments are one contiguous formatSpan() pass
+    // The qualified call is resolved at compile time (no further virtual dispatch)
+    void formatSegments(FormattedBatch& batch, size_t first, size_t last) override {
+        UpperCaseFormatter::formatSpan(std::span<char>(batch.data).subspan(
+            batch.offsets[first], batch.offsets[last] - batch.offsets[first]));
+    }
+
+    bool supportsChunking() const override { return true; }
+};
+
+// Concrete Strategy: Lowercase
+// LowerCaseFormatter is a concrete strategy that implements the ITextFormatter interface
+// It transforms the input string by converting all characters to lowercase
+class LowerCaseFormatter final : public BytewiseCaseFormatter {
+public:
+    const char* name() const override { return "lower"; }
+
+    gpu::CaseOp caseOp() const override { return gpu::CaseOp::lower; }
+
+    // Overrides the formatSpan kernel from the Interface superclass to apply lowercase transformation
+    // Iterates through each character in the caller's buffer and converts it to lowercase
+    void formatSpan(std::span<char> text) override {
+        // Fast path: vectorized ASCII kernel (only valid with the "C" tables)
+        if (tables->ascii && ascii_kernels::convert(text, ascii_kernels::CaseTarget::Lower))
+            return;
+        // Using range-based for loop to iterate through each character of the 'text' span
+        // Chars are accessed by reference and replaced in-place by their lowercase table entry
+        const unsigned char* lower = tables->lower;
+        for (char& c : text) c = static_cast<char>(lower[static_cast<unsigned char>(c)]);
+    }
+
+    void formatChunkInto(std::string_view source, std::span<char> dest, char) override {
+        if (tables->ascii && ascii_kernels::convertInto(source.data(), dest.data(), source.size(), ascii_kernels::CaseTarget::Lower))
+            return;
+        const unsigned char* lower = tables->lower;
+        for (size_t i = 0; i < source.size(); ++i)
+            dest[i] = static_cast<char>(lower[static_cast<unsigned char>(source[i])]);
+    }
+
+    // Lazy form: a random-access view of the lowercased bytes (see UpperCaseFormatter::view)
+    auto view(std::string_view text) const {
+        const unsigned char* lower = tables->lower;
+        return text | std::views::transform([lower](char c) {
+            return static_cast<char>(lower[static_cast<unsigned char>(c)]);
+        });
+    }
+
+    // Lowercasing is independent per byte, so the packed segments are one contiguous formatSpan() pass
+    void formatSegments(FormattedBatch& batch, size_t first, size_t last) override {
+        LowerCaseFormatter::formatSpan(std::span<char>(batch.data).subspan(
+            batch.offsets[first], batch.offsets[last] - batch.offsets[first]));
+    }
+
+    bool supportsChunking() const override { return true; }
+};
+
+// Concrete Strategy: Title Case
+// TitleCaseFormatter is a concrete strategy that implements the ITextFormatter interface
+// It transforms the input string by capitalizing the first letter of each word
+class TitleCaseFormatter final : public BytewiseCaseFormatter {
+public:
+    const char* name() const override { return "title"; }
+
+    gpu::CaseOp caseOp() const override { return gpu::CaseOp::title; }
+
+    // The start of the text behaves as if it followed a space, so the first word is capitalized
+    void formatSpan(std::span<char> text) override {
+        TitleCaseFormatter::formatChunk(text, ' ');
+    }
+
+    // Title case only looks one byte back: a chunk starts a word exactly when its
+    // preceding byte is whitespace, so chunks can be formatted independently
+    bool supportsChunking() const override { return true; }
+
+    void formatChunk(std::span<char> text, char preceding) override {
+        const CaseTables& t = *tables;
+        bool capitalize = t.space[static_cast<unsigned char>(preceding)];
+
+        // Fast path: vectorized word-boundary kernel (only valid with the "C" tables)
+        if (t.ascii && ascii_kernels::titleCase(text, capitalize))
+            return;
+
+        // Using range-based for loop to iterate through each character of the 'text' span
+        // The 'capitalize' flag tracks whether the current character is the start of a word
+        for (char& c : text) {
+            // Tables are indexed by unsigned char: a negative char (any UTF-8 byte on
+            // platforms where char is signed) would index before the start of the array
+            unsigned char u = static_cast<unsigned char>(c);
+            if (t.space[u]) {
+                capitalize = true; // Next non-space character starts a new word
+            }
+            else if (capitalize) {
+                c = static_cast<char>(t.upper[u]);    // Capitalize first letter of the word
+                capitalize = false;
+            }
+            else {
+                c = static_cast<char>(t.lower[u]);    // Lowercase the rest of the word
+            }
+        }
+    }
+
+    // One pass from 'source' to 'dest', with the same word-start rule as formatChunk()
+    void formatChunkInto(std::string_view source, std::span<char> dest, char preceding) override {
+        const CaseTables& t = *tables;
+        bool capitalize = t.space[static_cast<unsigned char>(preceding)];
+        if (t.ascii && ascii_kernels::titleCaseInto(source.data(), dest.data(), source.size(), capitalize))
+            return;
+        for (size_t i = 0; i < source.size(); ++i) {
+            unsigned char u = static_cast<unsigned char>(source[i]);
+            dest[i] = static_cast<char>(t.space[u] ? u : capitalize ? t.upper[u] : t.lower[u]);
+            capitalize = t.space[u];
+        }
+    }
+
+    // Lazy form: byte i only depends on bytes i - 1 and i (the same fact that makes chunking safe),
+    // so title case gets a random-access view too, not just a forward one
+    // The view refers to 'text' and to this strategy's tables, so it must not outlive either
+    // The transform receives each byte by reference into 'text', so the byte before it is c's
+    // neighbour in memory (the first byte is treated as following a space)
+    auto view(std::string_view text) const {
+        const CaseTables* t = tables;
+        const char* first = text.data();
+        return text | std::views::transform([t, first](const char& c) {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (t->space[u])
+                return static_cast<char>(u);
+            bool wordStart = &c == first || t->space[static_cast<unsigned char>((&c)[-1])];
+            return static_cast<char>(wordStart ? t->upper[u] : t->lower[u]);
+        });
+    }
+
+    // Each string starts a new word, so the segments are formatted one by one,
+    // but through a statically bound call rather than a virtual call per string
+    void formatSegments(FormattedBatch& batch, size_t first, size_t last) override {
+        for (size_t i = first; i < last; ++i)
+            TitleCaseFormatter::formatChunk(batch.segment(i), ' ');
+    }
+};
+
+// Rule-Based Title Case: configurable separators and stop words, compiled into a DFA
+// Educational Walkthrough Notes:
+// - TitleCaseFormatter starts a word after whitespace only; real titles also split words on
+//   hyphens, slashes and underscores ("state-of-the-art", "read/write") and keep short function
+//   words ("of", "the", "and") in lowercase
+// - Checking every finished word against a list would cost a string compare or a hash lookup
+//   per word; instead the constructor compiles the rules, once, into two tables:
+//   - byteClass[256]: 0 for separators, 1 for word bytes that occur in no stop word, and 2.. for
+//     the bytes of the stop words (an ASCII letter and its other case share one class, so stop
+//     words match case-insensitively)
+//   - delta: the stop-word trie laid out as a DFA (one row of 'classCount' next states per trie
+//     node); state 0 is dead (no stop word starts like this word), state 1 is the start of a word
+// - formatSpan() is a single pass: a word's first byte is capitalized and the rest lowercased
+//   immediately while the DFA follows along; if the word ends in an accepting state it was a stop
+//   word, and its first byte is patched back to lowercase (the only backtracking: one byte)
+// - Per byte that is two table loads and a case-table load; nothing is allocated and no word is
+//   ever compared or hashed
+// - The first word of the text, and of every line, keeps its capital even when it is a stop word
+//   (TitleCaseRules::capitalizeFirstWord), as headline style expects
+// - A stop word is only recognized when the word ends, so a byte's result can depend on bytes
+//   far after it: unlike TitleCaseFormatter, this strategy cannot be chunked
+struct TitleCaseRules {
+    std::string separators = " \t\n\v\f\r";
+    std::vector<std::string> stopWords;
+    bool capitalizeFirstWord = true;
+
+    // English headline style: words split on whitespace, '-', '/' and '_'; apostrophes stay
+    // inside words ("don't" becomes "Don't"); articles, conjunctions and short prepositions stay lowercase
+    static TitleCaseRules english() {
+        TitleCaseRules rules;
+        rules.separators += "-/_";
+        rules.stopWords = {"a", "an", "the", "and", "but", "or", "nor", "for", "so", "yet", "as", "at",
+                           "by", "in", "of", "off", "on", "per", "to", "up", "via", "vs"};
+        return rules;
+    }
+};
+
+class RuleTitleCaseFormatter final : public CaseTableFormatter {
+public:
+    // Throws std::invalid_argument for an empty stop word or one that contains a separator
+    explicit RuleTitleCaseFormatter(const TitleCaseRules& rules = TitleCaseRules::english())
+        : capitalizeFirstWord(rules.capitalizeFirstWord) {
+        compile(rules);
+    }
+
+    const char* name() const override { return "title-rules"; }
+
+    void formatSpan(std::span<char> text) override {
+        const CaseTables& t = *tables;
+        const uint32_t* next = delta.data();
+        const uint32_t wordRows = 2 * static_cast<uint32_t>(classCount); // rows below this are "before a word"
+        uint32_t row = lineStartRow;
+        size_t wordStart = 0, lineFirstWord = 0;
+
+        // A stop word loses its capital again, unless it is the first word of its line
+        auto endStopWord = [&] {
+            if (!(capitalizeFirstWord && wordStart == lineFirstWord))
+                text[wordStart] = static_cast<char>(t.lower[static_cast<unsigned char>(text[wordStart])]);
+        };
+
+        for (size_t i = 0; i < text.size(); ++i) {
+            unsigned char u = static_cast<unsigned char>(text[i]);
+            unsigned cls = byteClass[u];
+            // Separators map to themselves in both tables, so only word bytes actually change:
+            // the byte after a separator is capitalized, every other byte lowercased
+            bool beforeWord = row < wordRows;
+            text[i] = static_cast<char>(beforeWord ? t.upper[u] : t.lower[u]);
+            if (beforeWord) wordStart = i;
+            if (row == lineStartRow) lineFirstWord = i;
+            if (cls < firstWordByteClass && accepting[row]) endStopWord();
+            row = next[row + cls];
+        }
+        if (accepting[row]) endStopWord();
+    }
+
+private:
+    // Byte classes: separators that end a word, line breaks, other word bytes, then stop-word bytes
+    static constexpr unsigned separatorClass = 0, lineBreakClass = 1, firstWordByteClass = 2, plainClass = 2;
+    // DFA states: no word yet on this line, between words, inside a word that is no stop word
+    // (dead), then the trie root (only used while compiling) and the trie nodes
+    static constexpr uint32_t lineStartState = 0, betweenState = 1, deadState = 2, rootState = 3;
+    static constexpr uint32_t lineStartRow = 0;
+
+    void compile(const TitleCaseRules& rules) {
+        std::fill(std::begin(byteClass), std::end(byteClass), static_cast<unsigned char>(plainClass));
+        for (char c : rules.separators)
+            byteClass[static_cast<unsigned char>(c)] = c == '\n' ? lineBreakClass : separatorClass;
+
+        // Pass 1: give every byte used by a stop word its own class, shared with its other ASCII case
+        classCount = plainClass + 1;
+        for (const std::string& word : rules.stopWords) {
+            if (word.empty())
+                throw std::invalid_argument("RuleTitleCaseFormatter: empty stop word");
+            for (char c : word) {
+                unsigned char u = static_cast<unsigned char>(c);
+                if (byteClass[u] < firstWordByteClass)
+                    throw std::invalid_argument("RuleTitleCaseFormatter: stop word '" + word + "' contains a separator");
+                if (byteClass[u] == plainClass) {
+                    if (classCount > UINT8_MAX)
+                        throw std::length_error("RuleTitleCaseFormatter: too many distinct stop-word bytes");
+                    byteClass[asciiCaseTables.lower[u]] = static_cast<unsigned char>(classCount);
+                    byteClass[asciiCaseTables.upper[u]] = static_cast<unsigned char>(classCount);
+                    ++classCount;
+                }
+            }
+        }
+
+        // Every row starts out as "separator -> between words, line break -> line start,
+        // any word byte -> dead"; the line-start row additionally stays put on separators
+        std::vector<uint32_t> states;
+        auto addState = [&] {
+            size_t state = states.size() / classCount;
+            if (state * classCount > UINT32_MAX - 2 * classCount)
+                throw std::length_error("RuleTitleCaseFormatter: too many stop-word states");
+            states.resize(states.size() + classCount, deadState);
+            states[state * classCount + separatorClass] = betweenState;
+            states[state * classCount + lineBreakClass] = lineStartState;
+            accepting.resize(state + 1, 0);
+            return static_cast<uint32_t>(state);
+        };
+        for (uint32_t s = 0; s <= rootState; ++s) addState();
+        states[lineStartState * classCount + separatorClass] = lineStartState;
+
+        // Pass 2: insert the words into the trie below the root
+        for (const std::string& word : rules.stopWords) {
+            uint32_t state = rootState;
+            for (char c : word) {
+                size_t slot = state * classCount + byteClass[static_cast<unsigned char>(c)];
+                if (states[slot] == deadState) {
+                    uint32_t child = addState();
+                    states[slot] = child;
+                }
+                state = states[slot];
+            }
+            accepting[state] = 1;
+        }
+
+        // A word starts from either "before a word" state with the root's transitions
+        for (size_t cls = firstWordByteClass; cls < classCount; ++cls) {
+            states[lineStartState * classCount + cls] = states[rootState * classCount + cls];
+            states[betweenState * classCount + cls] = states[rootState * classCount + cls];
+        }
+
+        // Store row offsets instead of state numbers, so the loop does no multiplication, and
+        // index 'accepting' by row the same way
+        delta.resize(states.size());
+        for (size_t i = 0; i < states.size(); ++i)
+            delta[i] = states[i] * static_cast<uint32_t>(classCount);
+        std::vector<unsigned char> acceptingRows(states.size(), 0);
+        for (size_t s = 0; s < accepting.size(); ++s)
+            acceptingRows[s * classCount] = accepting[s];
+        accepting = std::move(acceptingRows);
+    }
+
+    unsigned char byteClass[256];
+    size_t classCount = 0;
+    std::vector<uint32_t> delta;             // row offset of the next state, per (row, class)
+    std::vector<unsigned char> accepting;    // per row offset: the word so far is a stop word
+    bool capitalizeFirstWord;
+};
+
+// Case-Insensitive Keys: hashing and comparison with the lowercase mapping fused in
+// Educational Walkthrough Notes:
+// - Normalizing a key for an unordered_map lookup with LowerCaseFormatter costs two passes and
+//   usually a temporary string: format the key, then hash the formatted copy
+// - CaseFoldHash and CaseFoldEqual lowercase the bytes inside their own loops instead, 16 bytes
+//   at a time (SSE2/NEON, the same range-compare trick as ascii_kernels), so nothing is copied
+// - Without a vector unit, 8 bytes are lowercased at once inside a 64-bit word (SWAR): every
+//   byte gets a flag bit (bit 7) computed by two additions, and the flags of the uppercase
+//   letters are shifted down onto their case bit (0x20); both paths give identical hashes
+// - Folding follows the "C" locale, exactly like the ASCII kernels: only 'A'..'Z' fold, and
+//   every other byte (including UTF-8 sequences) must match exactly
+// - Both functors are transparent (is_transparent), so a map keyed by CaseFoldedKey can be
+//   searched with a std::string_view and no key object is ever built for the lookup
+// - CaseFoldedKey keeps the key's original spelling and caches its folded hash, so rehashing
+//   a map never re-reads the key text
+namespace case_fold {
+
+// Lowercases the ASCII letters of 8 packed bytes; bytes >= 0x80 are left alone
+inline uint64_t lowerWord(uint64_t x) {
+    constexpr uint64_t ones = 0x0101010101010101ull;
+    uint64_t low7 = x & (0x7F * ones);
+    uint64_t atLeastA = low7 + (0x80 - 'A') * ones;  // bit 7 set where the byte is >= 'A'
+    uint64_t aboveZ = low7 + (0x7F - 'Z') * ones;    // bit 7 set where the byte is > 'Z'
+    uint64_t upper = (atLeastA ^ aboveZ) & ~x & (0x80 * ones);
+    return x | (upper >> 2);
+}
+
+inline uint64_t load64(const char* p) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+// Lowercases 16 bytes at 'p' into two words (vector unit when available, SWAR otherwise)
+inline void lowerBlock(const char* p, uint64_t out[2]) {
+#if defined(__SSE2__) && !defined(TEXTFORMATTER_FORCE_SCALAR)
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+    v = _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+#elif defined(__ARM_NEON) && !defined(TEXTFORMATTER_FORCE_SCALAR)
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+    uint8x16_t upper = vcleq_u8(vsubq_u8(v, vdupq_n_u8('A')), vdupq_n_u8(25));
+    v = vorrq_u8(v, vandq_u8(upper, vdupq_n_u8(0x20)));
+    vst1q_u8(reinterpret_cast<uint8_t*>(out), v);
+#else
+    out[0] = lowerWord(load64(p));
+    out[1] = lowerWord(load64(p + 8));
+#endif
+}
+
+// One hash round; the multiply of the new word does not depend on 'h', so rounds overlap
+inline uint64_t mixRound(uint64_t h, uint64_t w) {
+    return std::rotl(h ^ (w * 0x87C37B91114253D5ull), 31) * 0x4CF5AD432745937Full;
+}
+
+// Case-folded hash: two independent lanes over 16-byte blocks, a zero-padded tail, and a final
+// avalanche (MurmurHash3's fmix64); the length is mixed in so padding cannot collide
+inline size_t hash(std::string_view s) {
+    const char* p = s.data();
+    size_t n = s.size();
+    uint64_t h1 = 0x9E3779B97F4A7C15ull;
+    uint64_t h2 = 0xC2B2AE3D27D4EB4Full ^ n;
+    uint64_t block[2];
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        lowerBlock(p + i, block);
+        h1 = mixRound(h1, block[0]);
+        h2 = mixRound(h2, block[1]);
+    }
+    if (i < n) {
+        char tail[16] = {};
+        memcpy(tail, p + i, n - i);
+        lowerBlock(tail, block);
+        h1 = mixRound(h1, block[0]);
+        h2 = mixRound(h2, block[1]);
+    }
+    uint64_t h = h1 ^ std::rotl(h2, 32);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+}
+
+// Case-folded equality: lowercases both sides block by block and stops at the first difference
+inline bool equal(std::string_view a, std::string_view b) {
+    if (a.size() != b.size())
+        return false;
+    size_t n = a.size();
+    size_t i = 0;
+#if defined(__SSE2__) && !defined(TEXTFORMATTER_FORCE_SCALAR)
+    const __m128i lo = _mm_set1_epi8('A' - 1);
+    const __m128i hi = _mm_set1_epi8('Z' + 1);
+    const __m128i bit = _mm_set1_epi8(0x20);
+    auto fold = [&](__m128i v) {
+        return _mm_or_si128(v, _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi)), bit));
+    };
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = fold(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a.data() + i)));
+        __m128i y = fold(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b.data() + i)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF)
+            return false;
+    }
+#endif
+    for (; i + 8 <= n; i += 8)
+        if (lowerWord(load64(a.data() + i)) != lowerWord(load64(b.data() + i)))
+            return false;
+    for (; i < n; ++i)
+        if (asciiCaseTables.lower[static_cast<unsigned char>(a[i])] != asciiCaseTables.lower[static_cast<unsigned char>(b[i])])
+            return false;
+    return true;
+}
+
+} // namespace case_fold
+
+// A map key that compares and hashes case-insensitively, keeping its original spelling
+class CaseFoldedKey {
+private:
+    std::string text;
+    size_t hashValue = case_fold::hash({});
+
+public:
+    CaseFoldedKey() = default;
+    explicit CaseFoldedKey(std::string s) : text(std::move(s)), hashValue(case_fold::hash(text)) {}
+    explicit CaseFoldedKey(std::string_view s) : CaseFoldedKey(std::string(s)) {}
+    explicit CaseFoldedKey(const char* s) : CaseFoldedKey(std::string(s)) {}
+
+    const std::string& str() const { return text; }
+    operator std::string_view() const { return text; }
+    size_t hash() const { return hashValue; }
+
+    // The cached hashes reject most mismatches before any byte is compared
+    friend bool operator==(const CaseFoldedKey& a, const CaseFoldedKey& b) {
+        return a.hashValue == b.hashValue && case_fold::equal(a.text, b.text);
+    }
+    friend bool operator==(const CaseFoldedKey& a, std::string_view b) { return case_fold::equal(a.text, b); }
+};
+
+// Transparent functors: usable with std::string, std::string_view, const char* and CaseFoldedKey
+struct CaseFoldHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const { return case_fold::hash(s); }
+    size_t operator()(const CaseFoldedKey& k) const { return k.hash(); }
+};
+
+struct CaseFoldEqual {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const { return case_fold::equal(a, b); }
+    bool operator()(const CaseFoldedKey& a, const CaseFoldedKey& b) const { return a == b; }
+    bool operator()(const CaseFoldedKey& a, std::string_view b) const { return a == b; }
+    bool operator()(std::string_view a, const CaseFoldedKey& b) const { return b == a; }
+};
+
+// Case-insensitive map: map.find(std::string_view("Content-Type")) matches a "content-type" key
+template <typename V>
+using CaseFoldMap = std::unordered_map<CaseFoldedKey, V, CaseFoldHash, CaseFoldEqual>;
+
+// UTF-8 Case Mapping Engine
+// Educational Walkthrough Notes:
+// - The byte-oriented strategies above treat every char as a whole character, which is only true
+//   for ASCII: on UTF-8 text toupper() sees the individual bytes of a multibyte sequence
+// - This engine decodes UTF-8 into code points, maps each code point through a compact two-level
+//   table, and encodes the result again; bytes that are not valid UTF-8 are copied through unchanged
+// - Two-level table: the Basic Multilingual Plane is cut into 512 blocks of 128 code points;
+//   level one maps each block to a row of 16-bit deltas, and every block without case pairs shares
+//   the same all-zero row, so each direction needs only a few KB and stays resident in L1/L2
+// - Both tables are generated at compile time (constexpr) from the range rules listed below
+// - Some mappings change the byte length ('ß' -> "SS", 'ı' -> 'I', Kelvin sign -> 'k'), so every
+//   call first runs a sizing pass to learn the exact output size, then a writing pass
+// - ASCII runs are found 16 bytes at a time and handed to the SIMD ASCII kernels, so mostly-ASCII
+//   text costs little more than it does with the plain ASCII strategies
+namespace utf8_case {
+
+enum class Mode { Upper, Lower, Title };
+
+// Code points [first, last] map to cp + delta; with step 2 only first, first + 2, ... are mapped,
+// which describes the alternating Upper/lower pairs of the Latin Extended and Cyrillic blocks
+// 'invertible' rules also produce the opposite direction (lowercase -> uppercase) automatically
+struct CaseRule {
+    char32_t first;
+    char32_t last;
+    int32_t delta;
+    char32_t step;
+    bool invertible;
+};
+
+// Uppercase -> lowercase
+inline constexpr CaseRule lowerRules[] = {
+    {0x0041, 0x005A, 32, 1, true},                    // Basic Latin
+    {0x00C0, 0x00D6, 32, 1, true},                    // Latin-1 Supplement
+    {0x00D8, 0x00DE, 32, 1, true},
+    {0x0100, 0x012E, 1, 2, true},                     // Latin Extended-A pairs
+    {0x0130, 0x0130, 0x0069 - 0x0130, 1, false},      // İ -> i
+    {0x0132, 0x0136, 1, 2, true},
+    {0x0139, 0x0147, 1, 2, true},
+    {0x014A, 0x0176, 1, 2, true},
+    {0x0178, 0x0178, 0x00FF - 0x0178, 1, true},       // Ÿ -> ÿ
+    {0x0179, 0x017D, 1, 2, true},
+    {0x0386, 0x0386, 38, 1, true},                    // Greek, accented capitals
+    {0x0388, 0x038A, 37, 1, true},
+    {0x038C, 0x038C, 64, 1, true},
+    {0x038E, 0x038F, 63, 1, true},
+    {0x0391, 0x03A1, 32, 1, true},                    // Greek capitals
+    {0x03A3, 0x03AB, 32, 1, true},
+    {0x0400, 0x040F, 80, 1, true},                    // Cyrillic
+    {0x0410, 0x042F, 32, 1, true},
+    {0x0460, 0x0480, 1, 2, true},
+    {0x048A, 0x04BE, 1, 2, true},
+    {0x04C0, 0x04C0, 15, 1, true},
+    {0x04C1, 0x04CD, 1, 2, true},
+    {0x04D0, 0x052E, 1, 2, true},
+    {0x0531, 0x0556, 48, 1, true},                    // Armenian
+    {0x1E00, 0x1E94, 1, 2, true},                     // Latin Extended Additional
+    {0x1E9E, 0x1E9E, 0x00DF - 0x1E9E, 1, false},      // ẞ -> ß
+    {0x1EA0, 0x1EFE, 1, 2, true},
+    {0x2126, 0x2126, 0x03C9 - 0x2126, 1, false},      // Ohm sign -> ω
+    {0x212A, 0x212A, 0x006B - 0x212A, 1, false},      // Kelvin sign -> k
+    {0x212B, 0x212B, 0x00E5 - 0x212B, 1, false},      // Angstrom sign -> å
+    {0x2160, 0x216F, 16, 1, true},                    // Roman numerals
+    {0x24B6, 0x24CF, 26, 1, true},                    // Circled letters
+    {0xFF21, 0xFF3A, 32, 1, true},                    // Fullwidth Latin
+};
+
+// Lowercase -> uppercase mappings that are not the inverse of a rule above
+inline constexpr CaseRule extraUpperRules[] = {
+    {0x00B5, 0x00B5, 0x039C - 0x00B5, 1, false},      // micro sign -> Μ
+    {0x0131, 0x0131, 0x0049 - 0x0131, 1, false},      // ı -> I
+    {0x017F, 0x017F, 0x0053 - 0x017F, 1, false},      // ſ -> S
+    {0x03C2, 0x03C2, 0x03A3 - 0x03C2, 1, false},      // final ς -> Σ
+};
+
+constexpr bool ruleMaps(const CaseRule& r, char32_t first, char32_t last, char32_t cp) {
+    return cp >= first && cp <= last && (cp - first) % r.step == 0;
+}
+
+constexpr int32_t ruleDelta(char32_t cp, bool toUpper) {
+    if (!toUpper) {
+        for (const CaseRule& r : lowerRules)
+            if (ruleMaps(r, r.first, r.last, cp)) return r.delta;
+        return 0;
+    }
+    for (const CaseRule& r : extraUpperRules)
+        if (ruleMaps(r, r.first, r.last, cp)) return r.delta;
+    for (const CaseRule& r : lowerRules)
+        if (r.invertible && ruleMaps(r, r.first + r.delta, r.last + r.delta, cp)) return -r.delta;
+    return 0;
+}
+
+inline constexpr size_t blockBits = 7;
+inline constexpr size_t blockSize = size_t(1) << blockBits;
+inline constexpr size_t blockCount = 0x10000 >> blockBits;
+inline constexpr size_t maxRows = 32;
+
+struct CaseTable {
+    uint8_t rowOf[blockCount];
+    int16_t rows[maxRows][blockSize];
+
+    constexpr char32_t map(char32_t cp) const {
+        if (cp >= 0x10000) return cp;
+        return static_cast<char32_t>(int32_t(cp) + rows[rowOf[cp >> blockBits]][cp & (blockSize - 1)]);
+    }
+};
+
+// True if any rule (or inverted rule) can map a code point inside [first, last]
+// Lets the table builder skip the ~500 blocks without case pairs cheaply
+constexpr bool rulesTouch(char32_t first, char32_t last, bool toUpper) {
+    auto overlaps = [&](char32_t a, char32_t b) { return a <= last && b >= first; };
+    for (const CaseRule& r : lowerRules) {
+        if (!toUpper && overlaps(r.first, r.last)) return true;
+        if (toUpper && r.invertible && overlaps(r.first + r.delta, r.last + r.delta)) return true;
+    }
+    for (const CaseRule& r : extraUpperRules)
+        if (toUpper && overlaps(r.first, r.last)) return true;
+    return false;
+}
+
+constexpr CaseTable buildTable(bool toUpper) {
+    CaseTable table{};
+    size_t used = 1;                                   // row 0: the shared identity row
+    for (size_t b = 0; b < blockCount; ++b) {
+        if (!rulesTouch(char32_t(b * blockSize), char32_t(b * blockSize + blockSize - 1), toUpper))
+            continue;
+        int16_t row[blockSize]{};
+        bool any = false;
+        for (size_t i = 0; i < blockSize; ++i) {
+            row[i] = static_cast<int16_t>(ruleDelta(char32_t(b * blockSize + i), toUpper));
+            any = any || row[i] != 0;
+        }
+        if (!any)
+            continue;
+        size_t match = used;
+        for (size_t k = 1; k < used && match == used; ++k) {
+            bool same = true;
+            for (size_t i = 0; i < blockSize && same; ++i) same = table.rows[k][i] == row[i];
+            if (same) match = k;
+        }
+        if (match == used) {
+            if (used == maxRows) throw "utf8_case::buildTable: raise maxRows";
+            for (size_t i = 0; i < blockSize; ++i) table.rows[used][i] = row[i];
+            ++used;
+        }
+        table.rowOf[b] = static_cast<uint8_t>(match);
+    }
+    return table;
+}
+
+inline constexpr CaseTable upperTable = buildTable(true);
+inline constexpr CaseTable lowerTable = buildTable(false);
+
+// Non-ASCII whitespace (word separators for title case) besides the six ASCII isspace() bytes
+constexpr bool isUnicodeSpace(char32_t cp) {
+    return cp == 0x0085 || cp == 0x00A0 || cp == 0x1680 || (cp >= 0x2000 && cp <= 0x200A)
+        || cp == 0x2028 || cp == 0x2029 || cp == 0x202F || cp == 0x205F || cp == 0x3000;
+}
+
+constexpr bool isAsciiSpace(unsigned char c) {
+    return c == ' ' || static_cast<unsigned char>(c - '\t') < 5;
+}
+
+// Length of the leading run of ASCII bytes
+inline size_t asciiPrefixLength(const char* data, size_t size) {
+    size_t i = 0;
+#if defined(__SSE2__) && !defined(TEXTFORMATTER_FORCE_SCALAR)
+    for (; i + 16 <= size; i += 16) {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+        if (mask != 0)
+            return i + static_cast<size_t>(std::countr_zero(static_cast<unsigned>(mask)));
+    }
+#endif
+    while (i < size && static_cast<unsigned char>(data[i]) < 0x80) ++i;
+    return i;
+}
+
+// Decodes one multibyte sequence; returns its length, or 0 if the bytes are not valid UTF-8
+// (overlong forms, surrogates and code points above U+10FFFF are rejected)
+inline size_t decode(const unsigned char* p, size_t avail, char32_t& cp) {
+    auto cont = [&](size_t k) { return k < avail && (p[k] & 0xC0) == 0x80; };
+    unsigned char c = p[0];
+    if (c >= 0xC2 && c <= 0xDF && cont(1)) {
+        cp = char32_t(c & 0x1F) << 6 | (p[1] & 0x3F);
+        return 2;
+    }
+    if (c >= 0xE0 && c <= 0xEF && cont(1) && cont(2)) {
+        cp = char32_t(c & 0x0F) << 12 | char32_t(p[1] & 0x3F) << 6 | (p[2] & 0x3F);
+        return (cp >= 0x800 && (cp < 0xD800 || cp > 0xDFFF)) ? 3 : 0;
+    }
+    if (c >= 0xF0 && c <= 0xF4 && cont(1) && cont(2) && cont(3)) {
+        cp = char32_t(c & 0x07) << 18 | char32_t(p[1] & 0x3F) << 12 | char32_t(p[2] & 0x3F) << 6 | (p[3] & 0x3F);
+        return (cp >= 0x10000 && cp <= 0x10FFFF) ? 4 : 0;
+    }
+    return 0;
+}
+
+constexpr size_t encodedLength(char32_t cp) {
+    return cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+}
+
+inline size_t encode(char32_t cp, char* out) {
+    if (cp < 0x80) {
+        out[0] = static_cast<char>(cp);
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = static_cast<char>(0xC0 | (cp >> 6));
+        out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = static_cast<char>(0xE0 | (cp >> 12));
+        out[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xF0 | (cp >> 18));
+    out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// One-to-many mappings, which a delta table cannot express
+// 'titleCase' selects the title form used at the start of a word ("Ss" rather than "SS")
+inline size_t mapSpecial(char32_t cp, bool titleCase, char32_t out[2]) {
+    if (cp == 0x00DF) {                                // ß
+        out[0] = 'S';
+        out[1] = titleCase ? 's' : 'S';
+        return 2;
+    }
+    if (cp == 0x0149) {                                // ŉ -> ʼN
+        out[0] = 0x02BC;
+        out[1] = 'N';
+        return 2;
+    }
+    return 0;
+}
+
+// Core walker shared by the sizing pass (Write == false) and the writing pass (Write == true)
+// Returns the output size; 'sameLength' is cleared if any character changed its encoded length
+// In the writing pass 'out' may equal 'in' only when the sizing pass reported sameLength
+template <bool Write>
+size_t transform(const char* in, size_t size, char* out, Mode mode, bool& sameLength) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(in);
+    bool capitalize = true;
+    size_t i = 0, o = 0;
+    sameLength = true;
+    while (i < size) {
+        size_t run = asciiPrefixLength(in + i, size - i);
+        if (run > 0) {
+            // The kernels read the run and write its converted copy in the same pass
+            if constexpr (Write) {
+                if (mode == Mode::Title)
+                    ascii_kernels::activeTitleKernel(false)(in + i, out + o, run, capitalize);
+                else
+                    ascii_kernels::activeKernel(false)(in + i, out + o, run, mode == Mode::Upper ? 'a' : 'A');
+            }
+            capitalize = isAsciiSpace(bytes[i + run - 1]);
+            i += run;
+            o += run;
+            continue;
+        }
+
+        char32_t cp;
+        size_t length = decode(bytes + i, size - i, cp);
+        bool valid = length != 0;
+        if (!valid || isUnicodeSpace(cp)) {
+            // Invalid byte or Unicode space: copied through unchanged
+            // (an invalid byte counts as part of a word, a space starts a new one)
+            length = valid ? length : 1;
+            if constexpr (Write) memmove(out + o, in + i, length);
+            capitalize = valid;
+            i += length;
+            o += length;
+            continue;
+        }
+
+        bool upper = mode == Mode::Upper || (mode == Mode::Title && capitalize);
+        char32_t mapped[2];
+        size_t count = upper ? mapSpecial(cp, mode == Mode::Title, mapped) : 0;
+        if (count == 0) {
+            mapped[0] = upper ? upperTable.map(cp) : lowerTable.map(cp);
+            count = 1;
+        }
+        size_t outLength = 0;
+        for (size_t k = 0; k < count; ++k) {
+            if constexpr (Write)
+                outLength += encode(mapped[k], out + o + outLength);
+            else
+                outLength += encodedLength(mapped[k]);
+        }
+        sameLength = sameLength && outLength == length;
+        capitalize = false;
+        i += length;
+        o += outLength;
+    }
+    return o;
+}
+
+} // namespace utf8_case
+
+// Concrete Strategies: UTF-8 aware upper / lower / title case
+// Instructional notes:
+// - Same strategy interface, different algorithm family: these classes implement ITextFormatter
+//   with the UTF-8 engine above, so a TextProcessor can switch to them at runtime like any other
+// - They report isLengthPreserving() == false, which tells the engines to size the output first
+// - Utf8CaseFormatter holds the shared code; the three public classes only pick the Mode
+class Utf8CaseFormatter : public ITextFormatter {
+private:
+    utf8_case::Mode mode;
+
+    size_t measure(std::string_view text, bool& sameLength) const {
+        return utf8_case::transform<false>(text.data(), text.size(), nullptr, mode, sameLength);
+    }
+
+    void write(std::string_view text, char* out) const {
+        bool sameLength;
+        utf8_case::transform<true>(text.data(), text.size(), out, mode, sameLength);
+    }
+
+protected:
+    explicit Utf8CaseFormatter(utf8_case::Mode m) : mode(m) {}
+
+public:
+    // Keeps format(std::string&&) visible next to the override below: a moved-in string whose
+    // characters keep their byte lengths is then formatted in place, without a copy
+    using ITextFormatter::format;
+
+    // In place on a fixed-size buffer: only possible when no character changes its byte length
+    void formatSpan(std::span<char> text) override {
+        bool sameLength;
+        measure(std::string_view(text.data(), text.size()), sameLength);
+        if (!sameLength)
+            throw std::length_error("Utf8CaseFormatter::formatSpan: mapping changes the byte length");
+        write(std::string_view(text.data(), text.size()), text.data());
+    }
+
+    std::string format(const std::string& text) override {
+        bool sameLength;
+        std::string result(measure(text, sameLength), '\0');
+        write(text, result.data());
+        return result;
+    }
+
+    void formatInPlace(std::string& text) override {
+        bool sameLength;
+        size_t size = measure(text, sameLength);
+        if (sameLength) {
+            write(text, text.data());
+            return;
+        }
+        std::string result(size, '\0');
+        write(text, result.data());
+        text.swap(result);
+    }
+
+    void formatInto(std::string_view text, std::string& out) override {
+        bool sameLength;
+        out.resize(measure(text, sameLength));
+        write(text, out.data());
+    }
+
+    size_t formatInto(std::string_view text, std::span<char> out) override {
+        bool sameLength;
+        size_t size = measure(text, sameLength);
+        if (out.size() < size)
+            throw std::length_error("Utf8CaseFormatter::formatInto: output buffer too small");
+        write(text, out.data());
+        return size;
+    }
+
+    bool isLengthPreserving() const override { return false; }
+
+    size_t formattedSize(std::string_view text) override {
+        bool sameLength;
+        return measure(text, sameLength);
+    }
+};
+
+class Utf8UpperCaseFormatter final : public Utf8CaseFormatter {
+public:
+    Utf8UpperCaseFormatter() : Utf8CaseFormatter(utf8_case::Mode::Upper) {}
+    const char* name() const override { return "utf8-upper"; }
+};
+
+class Utf8LowerCaseFormatter final : public Utf8CaseFormatter {
+public:
+    Utf8LowerCaseFormatter() : Utf8CaseFormatter(utf8_case::Mode::Lower) {}
+    const char* name() const override { return "utf8-lower"; }
+};
+
+class Utf8TitleCaseFormatter final : public Utf8CaseFormatter {
+public:
+    Utf8TitleCaseFormatter() : Utf8CaseFormatter(utf8_case::Mode::Title) {}
+    const char* name() const override { return "utf8-title"; }
+};
+
+// Composite Strategy: a pipeline of formatters applied as one strategy
+// Educational Walkthrough Notes:
+// - Combines the Strategy pattern with the Composite pattern: a CompositeFormatter *is* an
+//   ITextFormatter, so a TextProcessor cannot tell a pipeline from a single strategy
+// - Stage fusion: upper, lower and title case each decide every letter's case from the
+//   whitespace around it alone, and none of them changes which bytes are whitespace;
+//   so in any run of consecutive built-in case stages only the last one matters
+//   (lower then upper == upper, lower then title == title, title then lower == lower)
+// - After fusion, consecutive stages that support chunking are run tile by tile: every stage
+//   processes one L1-sized tile before the next tile is touched, so the data stays in cache
+//   between stages instead of streaming the whole buffer through memory once per stage
+// - Stages that cannot be chunked run over the whole buffer, as they would on their own
+class CompositeFormatter final : public ITextFormatter {
+private:
+    // Stages in the order they were added (owned)
+    std::vector<std::unique_ptr<ITextFormatter>> stages;
+    // Stages that actually run, after fusion (non-owning pointers into 'stages')
+    std::vector<ITextFormatter*> plan;
+    // Tables bound by the context, handed on to stages added later as well
+    std::shared_ptr<const CaseTables> tables;
+
+    static bool isCaseStage(const ITextFormatter* f) {
+        return dynamic_cast<const UpperCaseFormatter*>(f) || dynamic_cast<const LowerCaseFormatter*>(f)
+            || dynamic_cast<const TitleCaseFormatter*>(f);
+    }
+
+    void rebuildPlan() {
+        plan.clear();
+        for (const auto& stage : stages) {
+            // A case stage replaces a case stage directly before it
+            if (!plan.empty() && isCaseStage(plan.back()) && isCaseStage(stage.get()))
+                plan.back() = stage.get();
+            else
+                plan.push_back(stage.get());
+        }
+    }
+
+    // Runs plan[first, last) (all chunkable) over 'text' one tile at a time
+    // lastInput[k] remembers the final byte of the previous tile *as stage k saw it*, which is
+    // exactly the 'preceding' byte stage k needs for the next tile
+    void runTiled(std::span<char> text, size_t first, size_t last) {
+        std::vector<char> lastInput(last - first, ' ');
+        for (size_t offset = 0; offset < text.size(); offset += tileSize) {
+            std::span<char> tile = text.subspan(offset, std::min(tileSize, text.size() - offset));
+            for (size_t k = first; k < last; ++k) {
+                char next = tile.back();
+                plan[k]->formatChunk(tile, lastInput[k - first]);
+                lastInput[k - first] = next;
+            }
+        }
+    }
+
+public:
+    // Tile size used between chunkable stages: small enough to stay resident in a 32 KB L1 cache
+    static constexpr size_t tileSize = 16 * 1024;
+
+    CompositeFormatter() = default;
+
+    explicit CompositeFormatter(std::vector<std::unique_ptr<ITextFormatter>> pipeline)
+        : stages(std::move(pipeline)) {
+        rebuildPlan();
+    }
+
+    // Appends a stage; returns *this so pipelines can be built fluently
+    CompositeFormatter& add(std::unique_ptr<ITextFormatter> stage) {
+        if (tables)
+            stage->useCaseTables(tables);
+        stages.push_back(std::move(stage));
+        rebuildPlan();
+        return *this;
+    }
+
+    // Number of stages that were added, and number that remain after fusion
+    size_t stageCount() const { return stages.size(); }
+    size_t fusedStageCount() const { return plan.size(); }
+
+    const char* name() const override { return "pipeline"; }
+
+    void useCaseTables(std::shared_ptr<const CaseTables> t) override {
+        tables = std::move(t);
+        for (const auto& stage : stages)
+            stage->useCaseTables(tables);
+    }
+
+    void formatSpan(std::span<char> text) override {
+        if (plan.size() == 1) {
+            plan.front()->formatSpan(text);
+            return;
+        }
+        size_t k = 0;
+        while (k < plan.size()) {
+            if (!plan[k]->supportsChunking()) {
+                plan[k++]->formatSpan(text);
+                continue;
+            }
+            size_t end = k;
+            while (end < plan.size() && plan[end]->supportsChunking()) ++end;
+            if (end - k == 1)
+                plan[k]->formatSpan(text);
+            else
+                runTiled(text, k, end);
+            k = end;
+        }
+    }
+
+    // A pipeline can only be chunked when it fused down to a single chunkable stage: with several
+    // stages, stage k would need the preceding byte as produced by stage k - 1, which a caller
+    // holding only the original text cannot supply
+    bool supportsChunking() const override {
+        return plan.size() == 1 && plan.front()->supportsChunking();
+    }
+
+    void formatChunk(std::span<char> chunk, char preceding) override {
+        if (plan.size() == 1)
+            plan.front()->formatChunk(chunk, preceding);
+        else
+            formatSpan(chunk);
+    }
+
+    void formatSegments(FormattedBatch& batch, size_t first, size_t last) override {
+        if (plan.size() == 1)
+            plan.front()->formatSegments(batch, first, last);
+        else
+            ITextFormatter::formatSegments(batch, first, last);
+    }
+
+    // A pipeline changes length as soon as one of its stages does; it then runs stage by stage
+    // through the std::string entry points, which every strategy supports
+    bool isLengthPreserving() const override {
+        return std::all_of(plan.begin(), plan.end(), [](const ITextFormatter* f) { return f->isLengthPreserving(); });
+    }
+
+    void formatInPlace(std::string& text) override {
+        if (isLengthPreserving()) {
+            formatSpan(text);
+            return;
+        }
+        for (ITextFormatter* stage : plan) stage->formatInPlace(text);
+    }
+
+    // Without this the override below would hide format(std::string&&), and a moved-in string
+    // would be copied even though formatInPlace() can work on it directly
+    using ITextFormatter::format;
+
+    std::string format(const std::string& text) override {
+        std::string result = text;
+        formatInPlace(result);
+        return result;
+    }
+
+    void formatInto(std::string_view text, std::string& out) override {
+        out.assign(text);
+        formatInPlace(out);
+    }
+
+    size_t formatInto(std::string_view text, std::span<char> out) override {
+        if (isLengthPreserving())
+            return ITextFormatter::formatInto(text, out);
+        std::string result(text);
+        formatInPlace(result);
+        if (out.size() < result.size())
+            throw std::length_error("CompositeFormatter::formatInto: output buffer too small");
+        return result.copy(out.data(), result.size());
+    }
+
+    size_t formattedSize(std::string_view text) override {
+        if (isLengthPreserving())
+            return text.size();
+        std::string result(text);
+        formatInPlace(result);
+        return result.size();
+    }
+};
+
+// Strategy Registry: name-based lookup, shared singletons, and plugin loading
+// Educational Walkthrough Notes:
+// - The demo used to pick a strategy with a hard-coded switch and make_unique a fresh object
+//   every time; a registry turns that into data: each strategy is registered once under a name
+//   and gets a small integer id (its index in a vector)
+// - find(name) is one hash-map lookup; instance(id) and create(id) are vector indexing, so a
+//   service that resolves names once at configuration time pays O(1) per message afterwards
+// - Stateless strategies (all the built-ins) are created once at registration and handed out
+//   as shared singletons: instance() costs a reference-count increment and no heap allocation
+// - Stateful strategies are created per instance() call, since sharing them would share state
+// - loadPlugin() adds strategies from a shared library: the library exports one C function,
+//   textformatter_register(), that receives the registry and calls add() for its strategies
+//   Libraries stay loaded for the life of the process, because their code backs the factories
+// - Registration is meant to happen at startup; lookups do not lock, so add() and loadPlugin()
+//   must not run while other threads are resolving strategies
+// - Singletons are bound to the locale's character tables when they are registered
+class FormatterRegistry {
+public:
+    using Id = uint32_t;
+    using Factory = std::function<std::unique_ptr<ITextFormatter>()>;
+
+    static constexpr Id invalidId = ~Id(0);
+
+    // Bumped whenever the plugin entry point, this class's layout or ITextFormatter's virtual
+    // functions change (2: isBytewise() / formatChunkInto())
+    static constexpr unsigned pluginAbiVersion = 2;
+
+    // Signature of the entry point every plugin exports (extern "C", returns false to refuse loading)
+    using PluginEntry = bool (*)(FormatterRegistry& registry, unsigned abiVersion);
+
+    // The process-wide registry, with the built-in strategies already registered
+    static FormatterRegistry& global() {
+        static FormatterRegistry registry = withBuiltins();
+        return registry;
+    }
+
+    // Registers a strategy and returns its id; throws std::invalid_argument for a duplicate name
+    Id add(std::string name, Factory factory, bool stateless = true) {
+        if (index.count(name))
+            throw std::invalid_argument("FormatterRegistry: duplicate strategy name '" + name + "'");
+        Entry entry{name, std::move(factory), nullptr};
+        if (stateless) {
+            entry.singleton = std::shared_ptr<ITextFormatter>(entry.factory());
+            entry.singleton->useCaseTables(CaseTables::forCurrentLocale());
+        }
+        Id id = static_cast<Id>(entries.size());
+        entries.push_back(std::move(entry));
+        index.emplace(std::move(name), id);
+        return id;
+    }
+
+    template <typename F>
+    Id add(std::string name) {
+        return add(std::move(name), [] { return std::make_unique<F>(); });
+    }
+
+    // Name -> id, or invalidId when the name is unknown (one hash lookup, no allocation)
+    Id find(std::string_view name) const {
+        auto it = index.find(name);
+        return it == index.end() ? invalidId : it->second;
+    }
+
+    bool contains(std::string_view name) const { return find(name) != invalidId; }
+
+    size_t size() const { return entries.size(); }
+    const std::string& name(Id id) const { return entries.at(id).name; }
+
+    // The strategy to use for 'id': the shared singleton if it is stateless, else a new object
+    // Returns nullptr for an unknown id
+    std::shared_ptr<ITextFormatter> instance(Id id) const {
+        if (id >= entries.size())
+            return nullptr;
+        const Entry& entry = entries[id];
+        if (entry.singleton)
+            return entry.singleton;
+        auto created = std::shared_ptr<ITextFormatter>(entry.factory());
+        created->useCaseTables(CaseTables::forCurrentLocale());
+        return created;
+    }
+
+    std::shared_ptr<ITextFormatter> instance(std::string_view name) const { return instance(find(name)); }
+
+    // A new, exclusively owned object (e.g. a CompositeFormatter stage); nullptr for an unknown id
+    std::unique_ptr<ITextFormatter> create(Id id) const {
+        return id < entries.size() ? entries[id].factory() : nullptr;
+    }
+
+    std::unique_ptr<ITextFormatter> create(std::string_view name) const { return create(find(name)); }
+
+    // Loads a plugin library and runs its textformatter_register() entry point
+    // Returns the number of strategies it added; throws std::runtime_error on failure
+    size_t loadPlugin(const std::string& path) {
+#if defined(_WIN32)
+        throw std::runtime_error("FormatterRegistry: plugins are not supported on this platform (" + path + ")");
+#else
+        void* library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!library)
+            throw std::runtime_error(std::string("FormatterRegistry: ") + dlerror());
+        auto entry = reinterpret_cast<PluginEntry>(dlsym(library, "textformatter_register"));
+        if (!entry) {
+            dlclose(library);
+            throw std::runtime_error("FormatterRegistry: " + path + " has no textformatter_register()");
+        }
+        size_t before = entries.size();
+        if (!entry(*this, pluginAbiVersion))
+            throw std::runtime_error("FormatterRegistry: " + path + " refused to load (ABI version mismatch?)");
+        return entries.size() - before;
+#endif
+    }
+
+private:
+    struct Entry {
+        std::string name;
+        Factory factory;
+        std::shared_ptr<ITextFormatter> singleton; // nullptr for stateful strategies
+    };
+
+    // Transparent hashing lets find() look a string_view up without building a std::string
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    std::vector<Entry> entries;
+    std::unordered_map<std::string, Id, NameHash, std::equal_to<>> index;
+
+    static FormatterRegistry withBuiltins() {
+        FormatterRegistry registry;
+        registry.add<UpperCaseFormatter>("upper");
+        registry.add<LowerCaseFormatter>("lower");
+        registry.add<TitleCaseFormatter>("title");
+        registry.add<RuleTitleCaseFormatter>("title-rules");
+        registry.add<Utf8UpperCaseFormatter>("utf8-upper");
+        registry.add<Utf8LowerCaseFormatter>("utf8-lower");
+        registry.add<Utf8TitleCaseFormatter>("utf8-title");
+        return registry;
+    }
+};
+
+// Execution Policies
+// Instructional notes:
+// - Modeled on std::execution::seq / std::execution::par: the policy object is passed as the
+//   first argument and selects an overload, it carries no state of its own
+// - The standard policies are not used directly because libstdc++ implements them on top of
+//   Intel TBB, which would become a link-time dependency of this small demo
+namespace format_policy {
+struct sequenced_policy {};
+struct parallel_policy {};
+inline constexpr sequenced_policy seq{};
+inline constexpr parallel_policy par{};
+} // namespace format_policy
+
+// String Column Adapter: formats an Arrow-layout string column in place of a row of std::strings
+// Educational Walkthrough Notes:
+// - Columnar stores (Apache Arrow StringArray / LargeStringArray, Parquet readers, many query
+//   engines) keep a string column as three buffers: 'offsets' (rows + 1 integers, row i spans
+//   data[offsets[i], offsets[i + 1])), the concatenated 'data' bytes, and an optional validity
+//   bitmap (bit i clear = row i is null); FormattedBatch above uses the same layout
+// - Building a std::string per row costs an allocation and a copy per row, and the column then has
+//   to be rebuilt; the adapter works on the buffers directly instead:
+//   - Length-preserving strategies keep every offset, so the offsets (and the validity bitmap)
+//     are reused unchanged and only a new data buffer is written
+//   - Chunkable strategies transform the whole data range in one formatChunkInto() sweep (the
+//     vectorized kernels for the built-ins), as if the rows were one text; the only bytes that
+//     come out wrong are each row's first byte, which the sweep saw after the previous row's last
+//     byte instead of "start of text"; those are gathered into one scratch buffer, each behind a
+//     space, formatted with one more call, and scattered back
+//   - That fix-up is exact because a chunkable strategy's output depends on nothing but a byte and
+//     the byte before it (see supportsChunking()); rows already preceded by a space are skipped
+//   - Other length-preserving strategies get one formatSpan() per row; length-changing ones
+//     (UTF-8) get new offsets, built with formattedSize() + formatInto() per row
+// - Null rows are formatted like any other (Arrow allows garbage bytes under a null; usually they
+//   are empty) and the bitmap is never read or written; it simply belongs to the output column too
+// - With -DTEXTFORMATTER_WITH_ARROW the arrow_adapter functions below wrap this for arrow::StringArray
+//   and arrow::LargeStringArray, sharing the input's offset and bitmap buffers (zero copies)
+namespace columnar {
+
+// Borrowed view of a string column; Offset is int32_t (StringArray) or int64_t (LargeStringArray)
+// 'offsets' starts at the column's first row (for a sliced Arrow array: raw_value_offsets()) and
+// its values index 'data' directly, so offsets.front() need not be 0
+template <typename Offset>
+struct StringColumnView {
+    std::span<const Offset> offsets;    // rows() + 1 entries
+    const char* data = nullptr;         // the buffer the offsets index into
+    const uint8_t* validity = nullptr;  // LSB-first null bitmap, nullptr when every row is valid
+    int64_t validityOffset = 0;         // bit of row 0 in 'validity'
+
+    size_t rows() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+    bool isNull(size_t row) const {
+        if (!validity)
+            return false;
+        uint64_t bit = static_cast<uint64_t>(validityOffset) + row;
+        return (validity[bit / 8] >> (bit % 8) & 1) == 0;
+    }
+
+    std::string_view value(size_t row) const {
+        return std::string_view(data + offsets[row], static_cast<size_t>(offsets[row + 1] - offsets[row]));
+    }
+};
+
+// Result of formatColumn()
+// - offsetsReused: the input offsets index 'data' unchanged (and 'offsets' is left empty); data is
+//   then offsets.back() bytes long, with the bytes before offsets.front() zero
+// - otherwise 'offsets' holds rows + 1 new entries starting at 0
+template <typename Offset>
+struct FormattedColumn {
+    std::vector<Offset> offsets;
+    std::string data;
+    bool offsetsReused = false;
+};
+
+template <typename Offset>
+size_t checkedOffset(Offset offset) {
+    if (offset < 0)
+        throw std::invalid_argument("columnar: negative offset in a string column");
+    return static_cast<size_t>(offset);
+}
+
+// value(row) after checking the row's two offsets (non-negative, not decreasing), for the paths
+// that index the data row by row; throws std::invalid_argument like formatRows() does
+template <typename Offset>
+std::string_view checkedValue(const StringColumnView<Offset>& column, size_t row) {
+    size_t start = checkedOffset(column.offsets[row]), stop = checkedOffset(column.offsets[row + 1]);
+    if (stop < start)
+        throw std::invalid_argument("columnar: offsets are not increasing");
+    return std::string_view(column.data + start, stop - start);
+}
+
+// Formats the rows of one column range from 'source' into 'dest' (same positions, both indexed
+// by 'offsets'; they may be the same buffer) with a length-preserving strategy
+template <typename Offset>
+void formatRows(ITextFormatter& f, std::span<const Offset> offsets, const char* source, char* dest) {
+    if (offsets.size() < 2)
+        return;
+    size_t begin = checkedOffset(offsets.front()), end = checkedOffset(offsets.back());
+    if (end < begin)
+        throw std::invalid_argument("columnar: offsets are not increasing");
+
+    if (!f.supportsChunking()) {
+        if (dest != source)
+            memcpy(dest + begin, source + begin, end - begin);
+        for (size_t row = 0; row + 1 < offsets.size(); ++row) {
+            size_t start = checkedOffset(offsets[row]), stop = checkedOffset(offsets[row + 1]);
+            if (stop < start || stop > end)
+                throw std::invalid_argument("columnar: offsets are not increasing");
+            f.formatSpan(std::span<char>(dest + start, stop - start));
+        }
+        return;
+    }
+
+    // Groups of up to fixupBatch rows: each group is swept as one text (it starts a row, so the byte
+    // before it counts as a space), after its row starts have been gathered, since the sweep
+    // overwrites them when formatting in place; the scratch buffers stay on the stack
+    constexpr size_t fixupBatch = 1024;
+    char fixups[2 * fixupBatch];
+    size_t fixupAt[fixupBatch];
+    const size_t rows = offsets.size() - 1;
+    for (size_t first = 0; first < rows; first += fixupBatch) {
+        size_t last = std::min(rows, first + fixupBatch);
+        size_t groupBegin = checkedOffset(offsets[first]), groupEnd = checkedOffset(offsets[last]);
+        if (groupEnd < groupBegin || groupEnd > end)
+            throw std::invalid_argument("columnar: offsets are not increasing");
+        size_t count = 0;
+        for (size_t row = first + 1; row < last; ++row) {
+            size_t start = checkedOffset(offsets[row]), stop = checkedOffset(offsets[row + 1]);
+            if (start < checkedOffset(offsets[row - 1]) || stop < start || stop > groupEnd)
+                throw std::invalid_argument("columnar: offsets are not increasing");
+            if (stop > start && start > groupBegin && source[start - 1] != ' ') {
+                fixups[2 * count] = ' ';
+                fixups[2 * count + 1] = source[start];
+                fixupAt[count++] = start;
+            }
+        }
+        f.formatChunkInto(std::string_view(source + groupBegin, groupEnd - groupBegin),
+                          std::span<char>(dest + groupBegin, groupEnd - groupBegin), ' ');
+        if (count == 0)
+            continue;
+        f.formatChunkInto(std::string_view(fixups, 2 * count), std::span<char>(fixups, 2 * count), ' ');
+        for (size_t i = 0; i < count; ++i)
+            dest[fixupAt[i]] = fixups[2 * i + 1];
+    }
+}
+
+// Formats every row of 'column' with 'f' (see FormattedColumn for the result layout)
+template <typename Offset>
+void formatColumn(ITextFormatter& f, const StringColumnView<Offset>& column, FormattedColumn<Offset>& out) {
+    out.offsets.clear();
+    out.data.clear();
+    size_t rows = column.rows();
+    if (f.isLengthPreserving()) {
+        out.offsetsReused = true;
+        if (column.offsets.empty())
+            return;
+        out.data.assign(checkedOffset(column.offsets.back()), '\0');
+        formatRows(f, column.offsets, column.data, out.data.data());
+        return;
+    }
+
+    out.offsetsReused = false;
+    out.offsets.reserve(rows + 1);
+    out.offsets.push_back(0);
+    size_t total = 0;
+    for (size_t row = 0; row < rows; ++row) {
+        total += f.formattedSize(checkedValue(column, row));
+        if (total > static_cast<size_t>(std::numeric_limits<Offset>::max()))
+            throw std::length_error("columnar: formatted column exceeds the offset type's range");
+        out.offsets.push_back(static_cast<Offset>(total));
+    }
+    out.data.resize(total);
+    // Every row was validated by the sizing pass above
+    for (size_t row = 0; row < rows; ++row) {
+        auto start = static_cast<size_t>(out.offsets[row]);
+        f.formatInto(column.value(row), std::span<char>(out.data).subspan(start, static_cast<size_t>(out.offsets[row + 1]) - start));
+    }
+}
+
+// Rewrites the data buffer of a column in place; only for length-preserving strategies
+// (throws std::invalid_argument otherwise, since the offsets would have to change)
+template <typename Offset>
+void formatColumnInPlace(ITextFormatter& f, std::span<const Offset> offsets, char* data) {
+    if (!f.isLengthPreserving())
+        throw std::invalid_argument("columnar::formatColumnInPlace: strategy changes the length of its input");
+    formatRows(f, offsets, data, data);
+}
+
+} // namespace columnar
+
+#if defined(TEXTFORMATTER_WITH_ARROW)
+// Apache Arrow Adapter
+// Educational note:
+// - format() returns a new array of the same type sharing the input's offsets and validity buffers
+//   (for length-preserving strategies) plus one newly allocated data buffer from 'pool'; only
+//   length-changing strategies allocate an offsets buffer
+// - A sliced input keeps its slice offset: the new offsets buffer of a length-changing strategy
+//   starts with zeros for the rows before the slice, so the validity bitmap still lines up untouched
+// - Arrow reports failures as arrow::Status; they are rethrown as std::runtime_error here, the
+//   way the rest of this header reports errors
+namespace arrow_adapter {
+
+inline std::shared_ptr<arrow::Buffer> allocate(int64_t size, arrow::MemoryPool* pool) {
+    auto buffer = arrow::AllocateBuffer(size, pool);
+    if (!buffer.ok())
+        throw std::runtime_error("arrow_adapter: " + buffer.status().ToString());
+    return std::shared_ptr<arrow::Buffer>(std::move(buffer).ValueUnsafe());
+}
+
+// ArrayType: arrow::StringArray, arrow::LargeStringArray (or their Binary counterparts)
+template <typename ArrayType>
+std::shared_ptr<ArrayType> format(ITextFormatter& f, const ArrayType& array,
+                                  arrow::MemoryPool* pool = arrow::default_memory_pool()) {
+    using Offset = typename ArrayType::offset_type;
+    const size_t rows = static_cast<size_t>(array.length());
+    columnar::StringColumnView<Offset> column;
+    column.offsets = std::span<const Offset>(array.raw_value_offsets(), rows + 1);
+    column.data = array.value_data() ? reinterpret_cast<const char*>(array.value_data()->data()) : "";
+
+    if (f.isLengthPreserving()) {
+        int64_t size = static_cast<int64_t>(column.offsets.back());
+        std::shared_ptr<arrow::Buffer> data = allocate(size, pool);
+        char* dest = reinterpret_cast<char*>(data->mutable_data());
+        memset(dest, 0, static_cast<size_t>(column.offsets.front()));
+        columnar::formatRows(f, column.offsets, column.data, dest);
+        return std::make_shared<ArrayType>(array.length(), array.value_offsets(), data, array.null_bitmap(),
+                                           array.null_count(), array.offset());
+    }
+
+    columnar::FormattedColumn<Offset> formatted;
+    columnar::formatColumn(f, column, formatted);
+    const size_t lead = static_cast<size_t>(array.offset());
+    std::shared_ptr<arrow::Buffer> offsets = allocate(static_cast<int64_t>((lead + rows + 1) * sizeof(Offset)), pool);
+    Offset* raw = reinterpret_cast<Offset*>(offsets->mutable_data());
+    std::fill(raw, raw + lead, Offset(0));
+    std::copy(formatted.offsets.begin(), formatted.offsets.end(), raw + lead);
+    std::shared_ptr<arrow::Buffer> data = allocate(static_cast<int64_t>(formatted.data.size()), pool);
+    memcpy(data->mutable_data(), formatted.data.data(), formatted.data.size());
+    return std::make_shared<ArrayType>(array.length(), offsets, data, array.null_bitmap(),
+                                       array.null_count(), array.offset());
+}
+
+// Convenience overload dispatching on the array's type (string and large_string)
+inline std::shared_ptr<arrow::Array> format(ITextFormatter& f, const arrow::Array& array,
+                                            arrow::MemoryPool* pool = arrow::default_memory_pool()) {
+    switch (array.type_id()) {
+    case arrow::Type::STRING:
+        return format(f, static_cast<const arrow::StringArray&>(array), pool);
+    case arrow::Type::LARGE_STRING:
+        return format(f, static_cast<const arrow::LargeStringArray&>(array), pool);
+    default:
+        throw std::invalid_argument("arrow_adapter::format: expected a string or large_string array, got "
+                                    + array.type()->ToString());
+    }
+}
+
+} // namespace arrow_adapter
+#endif
+
+// Machine Topology: NUMA nodes, the CPUs on each, cache and page sizes
+// Educational Walkthrough Notes:
+// - On a multi-socket machine every socket (NUMA node) has its own memory; a thread reading
+//   memory that belongs to another node goes over the interconnect, at a fraction of the bandwidth
+// - Linux describes the layout in sysfs: /sys/devices/system/node/nodeN/cpulist lists the CPUs of
+//   node N, and /sys/devices/system/cpu/cpuN/cache/indexK/ the caches of CPU N; both are plain
+//   text, so no libnuma (and no extra link dependency) is needed
+// - Only CPUs in the process's affinity mask are kept, so a run under taskset or numactl
+//   --cpunodebind sees just the nodes it may use
+// - pageNodes() asks the kernel where pages already live: move_pages() with no target nodes
+//   moves nothing and only reports each page's node (or a negative errno for pages never touched)
+// - Everything degrades to "one node holding every CPU" on machines without NUMA, and off Linux
+namespace topology {
+
+struct Node {
+    unsigned id = 0;            // kernel node number
+    std::vector<unsigned> cpus; // CPUs of this node the process may run on
+};
+
+struct Topology {
+    std::vector<Node> nodes;             // nodes with at least one usable CPU, in id order
+    size_t l2CacheSize = 1024 * 1024;    // per core; a conservative default when unreadable
+    size_t pageSize = 4096;
+
+    unsigned cpuCount() const {
+        size_t total = 0;
+        for (const Node& node : nodes) total += node.cpus.size();
+        return static_cast<unsigned>(total);
+    }
+
+    // Index into 'nodes' of the node holding 'cpu' (0 when the CPU is unknown)
+    size_t nodeOfCpu(unsigned cpu) const {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (std::find(nodes[i].cpus.begin(), nodes[i].cpus.end(), cpu) != nodes[i].cpus.end())
+                return i;
+        }
+        return 0;
+    }
+
+    // Index into 'nodes' of kernel node 'id', or nodes.size() when no usable CPU is on it
+    size_t indexOfNode(int id) const {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (static_cast<int>(nodes[i].id) == id)
+                return i;
+        }
+        return nodes.size();
+    }
+};
+
+#if defined(__linux__)
+// Parses a sysfs list of CPU or node ids such as "0-3,8-11"
+inline std::vector<unsigned> parseIdList(const char* text) {
+    std::vector<unsigned> cpus;
+    while (*text) {
+        char* end;
+        unsigned long first = strtoul(text, &end, 10);
+        if (end == text)
+            break;
+        unsigned long last = first;
+        if (*end == '-')
+            last = strtoul(end + 1, &end, 10);
+        for (unsigned long cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(static_cast<unsigned>(cpu));
+        text = *end == ',' ? end + 1 : end;
+    }
+    return cpus;
+}
+
+// First line of a small sysfs file, or "" when it cannot be read
+inline std::string readLine(const std::string& path) {
+    char buffer[4096] = {};
+    FILE* file = fopen(path.c_str(), "r");
+    if (!file)
+        return std::string();
+    if (!fgets(buffer, sizeof(buffer), file))
+        buffer[0] = '\0';
+    fclose(file);
+    std::string line(buffer);
+    while (!line.empty() && (line.back() == '\n' || line.back() == ' '))
+        line.pop_back();
+    return line;
+}
+
+// Size of the L2 data (or unified) cache seen by 'cpu', 0 when sysfs does not say
+inline size_t readL2Size(unsigned cpu) {
+    std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cache/index";
+    for (int index = 0; index < 8; ++index) {
+        std::string dir = base + std::to_string(index) + "/";
+        std::string level = readLine(dir + "level");
+        if (level.empty())
+            break;
+        if (level != "2" || readLine(dir + "type") == "Instruction")
+            continue;
+        std::string size = readLine(dir + "size");
+        char* unit;
+        size_t value = strtoull(size.c_str(), &unit, 10);
+        if (*unit == 'K') value <<= 10;
+        else if (*unit == 'M') value <<= 20;
+        return value;
+    }
+    return 0;
+}
+#endif
+
+inline Topology detect() {
+    Topology topo;
+#if defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool haveMask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    auto usable = [&](unsigned cpu) { return !haveMask || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)); };
+
+    // "online" lists the node ids (which can have holes); kernels without NUMA have no such file
+    std::string online = readLine("/sys/devices/system/node/online");
+    for (unsigned id : parseIdList(online.c_str())) {
+        std::string list = readLine("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+        Node node;
+        node.id = id;
+        for (unsigned cpu : parseIdList(list.c_str()))
+            if (usable(cpu)) node.cpus.push_back(cpu);
+        if (!node.cpus.empty())
+            topo.nodes.push_back(std::move(node));
+    }
+    if (topo.nodes.empty() && haveMask) {
+        Node node;
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &allowed)) node.cpus.push_back(cpu);
+        topo.nodes.push_back(std::move(node));
+    }
+    if (!topo.nodes.empty()) {
+        if (size_t l2 = readL2Size(topo.nodes[0].cpus[0]))
+            topo.l2CacheSize = l2;
+    }
+    long page = sysconf(_SC_PAGESIZE);
+    if (page > 0)
+        topo.pageSize = static_cast<size_t>(page);
+#endif
+    if (topo.nodes.empty()) {
+        Node node;
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu)
+            node.cpus.push_back(cpu);
+        topo.nodes.push_back(std::move(node));
+    }
+    return topo;
+}
+
+// Detected once per process
+inline const Topology& current() {
+    static const Topology topo = detect();
+    return topo;
+}
+
+// Kernel node of the page holding each address, or -1 when it is unknown (page not resident
+// yet, not a NUMA kernel, or not Linux); one system call for the whole list
+inline std::vector<int> pageNodes(const std::vector<const void*>& addresses) {
+    std::vector<int> nodes(addresses.size(), -1);
+#if defined(__linux__) && defined(SYS_move_pages)
+    if (addresses.empty() || current().nodes.size() < 2)
+        return nodes;
+    std::vector<void*> pages(addresses.size());
+    for (size_t i = 0; i < addresses.size(); ++i)
+        pages[i] = const_cast<void*>(addresses[i]);
+    if (syscall(SYS_move_pages, 0, static_cast<unsigned long>(pages.size()), pages.data(), nullptr, nodes.data(), 0) != 0)
+        std::fill(nodes.begin(), nodes.end(), -1);
+    for (int& node : nodes)
+        if (node < 0) node = -1;
+#endif
+    return nodes;
+}
+
+// Binds the calling thread to one CPU; returns false where that is not possible
+inline bool pinCurrentThread(unsigned cpu) {
+#if defined(__linux__)
+    if (cpu >= CPU_SETSIZE)
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// Per-node report of one topology-aware parallel call (see TextProcessor::nodeThroughput())
+struct NodeThroughput {
+    unsigned node = 0;       // kernel node number
+    unsigned workers = 0;    // workers pinned to the node
+    size_t bytes = 0;        // bytes formatted by threads running on the node
+    size_t remoteBytes = 0;  // of those, bytes whose input pages were found on another node
+    double seconds = 0;      // from the node's first chunk start to its last chunk end
+
+    double bytesPerSecond() const { return seconds > 0 ? double(bytes) / seconds : 0.0; }
+};
+
+// Index into current().nodes of the node the calling thread runs on right now
+inline size_t currentNode() {
+#if defined(__linux__)
+    int cpu = sched_getcpu();
+    if (cpu >= 0)
+        return current().nodeOfCpu(static_cast<unsigned>(cpu));
+#endif
+    return 0;
+}
+
+} // namespace topology
+
+// Work-Stealing Thread Pool
+// Educational Walkthrough Notes:
+// - Every worker owns a double-ended queue of tasks; submit() deals tasks out round-robin
+// - A worker pops from the back of its own queue (most recently added, still warm in cache)
+//   and, when that is empty, steals from the front of another worker's queue, so uneven
+//   tasks (one huge string next to many tiny ones) still keep every core busy
+// - runAll() is the only blocking entry point: the calling thread helps execute tasks
+//   instead of sleeping, and the first exception thrown by any task is rethrown to the caller
+// - A pool built from a CPU list pins worker i to cpus[i] (the topology-aware engine passes the
+//   CPUs grouped by NUMA node, so a worker's neighbouring queues, the first ones it steals from,
+//   belong to the same node); runAllOn() places each task on a chosen worker's queue
+class ThreadPool {
+private:
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> nextQueue{0};
+    bool stopping = false;
+
+    // Runs one task, preferring queue 'home'; returns false if every queue was empty
+    bool tryRunOne(size_t home) {
+        for (size_t n = 0; n < queues.size(); ++n) {
+            WorkQueue& q = *queues[(home + n) % queues.size()];
+            std::function<void()> task;
+            {
+                std::lock_guard<std::mutex> guard(q.lock);
+                if (q.tasks.empty())
+                    continue;
+                if (n == 0) {
+                    task = std::move(q.tasks.back());
+                    q.tasks.pop_back();
+                }
+                else {
+                    task = std::move(q.tasks.front());
+                    q.tasks.pop_front();
+                }
+            }
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            task();
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(size_t index, int cpu) {
+        if (cpu >= 0)
+            topology::pinCurrentThread(static_cast<unsigned>(cpu));
+        for (;;) {
+            if (tryRunOne(index))
+                continue;
+            std::unique_lock<std::mutex> guard(sleepLock);
+            wake.wait(guard, [this] { return stopping || queued.load() > 0; });
+            if (stopping && queued.load() == 0)
+                return;
+        }
+    }
+
+public:
+    // threadCount == 0 means "one worker per hardware thread"
+    explicit ThreadPool(unsigned threadCount = 0) {
+        if (threadCount == 0)
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 0; i < threadCount; ++i)
+            queues.push_back(std::make_unique<WorkQueue>());
+        for (unsigned i = 0; i < threadCount; ++i)
+            workers.emplace_back([this, i] { workerLoop(i, -1); });
+    }
+
+    // One worker per entry, pinned to that CPU
+    explicit ThreadPool(const std::vector<unsigned>& cpus) {
+        for (size_t i = 0; i < std::max<size_t>(1, cpus.size()); ++i)
+            queues.push_back(std::make_unique<WorkQueue>());
+        if (cpus.empty())
+            workers.emplace_back([this] { workerLoop(0, -1); });
+        for (size_t i = 0; i < cpus.size(); ++i)
+            workers.emplace_back([this, i, cpu = static_cast<int>(cpus[i])] { workerLoop(i, cpu); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) t.join();
+    }
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    void submit(std::function<void()> task) {
+        submitTo(nextQueue.fetch_add(1, std::memory_order_relaxed), std::move(task));
+    }
+
+    // Queues a task on worker 'worker' (modulo size()); other workers may still steal it
+    void submitTo(size_t worker, std::function<void()> task) {
+        WorkQueue& q = *queues[worker % queues.size()];
+        {
+            std::lock_guard<std::mutex> guard(q.lock);
+            q.tasks.push_back(std::move(task));
+        }
+        queued.fetch_add(1);
+        // Taking the sleep lock orders this wake-up after a worker's predicate check
+        { std::lock_guard<std::mutex> guard(sleepLock); }
+        wake.notify_one();
+    }
+
+    // Runs body(0) ... body(count - 1) on the pool and returns once all of them have finished
+    void runAll(size_t count, const std::function<void(size_t)>& body) {
+        runTasks(count, body, nullptr);
+    }
+
+    // Runs body(i) on workers[i]'s queue for every i; the caller only waits, so a task runs on
+    // its (pinned) worker unless that worker is busy long enough for another one to steal it
+    // (not to be called from inside a task of the same pool: the caller does not help)
+    void runAllOn(std::span<const size_t> workers, const std::function<void(size_t)>& body) {
+        runTasks(workers.size(), body, workers.data());
+    }
+
+private:
+    void runTasks(size_t count, const std::function<void(size_t)>& body, const size_t* placement) {
+        std::atomic<size_t> remaining{count};
+        std::mutex doneLock;
+        std::condition_variable done;
+        std::exception_ptr failure;
+
+        for (size_t i = 0; i < count; ++i) {
+            auto task = [&, i] {
+                try {
+                    body(i);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> guard(doneLock);
+                    if (!failure) failure = std::current_exception();
+                }
+                // Count down under the lock: the waiter below only sees 0 once this task has
+                // released doneLock, and after that the task never touches this stack frame again.
+                // Decrementing first and locking afterwards would let the waiter return (and
+                // destroy doneLock and done) between the two steps
+                std::lock_guard<std::mutex> guard(doneLock);
+                if (remaining.fetch_sub(1) == 1)
+                    done.notify_all();
+            };
+            if (placement)
+                submitTo(placement[i], std::move(task));
+            else
+                submit(std::move(task));
+        }
+
+        // Help out until nothing is left to steal, then wait for the tasks still in flight
+        while (!placement && remaining.load() > 0 && tryRunOne(0)) {}
+        std::unique_lock<std::mutex> guard(doneLock);
+        done.wait(guard, [&] { return remaining.load() == 0; });
+        if (failure)
+            std::rethrow_exception(failure);
+    }
+};
+
+// Result Cache: memoizes formatted results for repeated inputs
+// Educational Walkthrough Notes:
+// - Workloads that format the same short strings over and over (product names, headers,
+//   enum-like tokens) pay for the same transformation every time; the cache remembers each result
+// - Keys are (strategy id, input): TextProcessor hands out a fresh strategy id on every
+//   setFormatter(), so results of a replaced strategy can never be returned by mistake
+// - Results are stored as shared_ptr<const std::string>, so a hit costs one reference-count
+//   increment: nothing is recomputed and nothing is allocated
+// - The cache is bounded and sharded: the key's hash picks one of 'shardCount' shards, each with
+//   its own lock and a fixed array of slots, so threads formatting different keys rarely meet
+// - Eviction is CLOCK (second chance): a hit sets the slot's 'referenced' bit; to make room the
+//   hand sweeps the slots, clearing set bits and evicting the first slot whose bit is already clear
+//   Hot keys therefore survive a sweep, while keys seen only once are replaced first
+// - Lookups take the shard lock in shared mode (the referenced bit is atomic), so concurrent
+//   hits on the same shard do not serialize; only inserts take it exclusively
+// - hits()/misses() make it easy to see whether a stream repeats enough to be worth caching
+class FormatCache {
+public:
+    static constexpr size_t shardCount = 16;
+
+    explicit FormatCache(size_t capacity = 4096) {
+        size_t perShard = std::max<size_t>(1, (capacity + shardCount - 1) / shardCount);
+        for (Shard& shard : shards)
+            shard.slots = std::vector<Slot>(perShard);
+    }
+
+    FormatCache(const FormatCache&) = delete;
+    FormatCache& operator=(const FormatCache&) = delete;
+
+    // Returns the cached result, or nullptr (and counts a miss) when the key is not present
+    std::shared_ptr<const std::string> find(uint64_t strategyId, std::string_view text) {
+        uint64_t key = keyOf(strategyId, text);
+        Shard& shard = shardOf(key);
+        {
+            std::shared_lock<std::shared_mutex> guard(shard.lock);
+            auto it = shard.index.find(key);
+            if (it != shard.index.end()) {
+                Slot& slot = shard.slots[it->second];
+                if (slot.strategyId == strategyId && slot.input == text) {
+                    slot.referenced.store(true, std::memory_order_relaxed);
+                    shard.hits.fetch_add(1, std::memory_order_relaxed);
+                    return slot.result;
+                }
+            }
+        }
+        shard.misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    // Stores a result, evicting with the CLOCK hand when the shard is full
+    void insert(uint64_t strategyId, std::string_view text, std::shared_ptr<const std::string> result) {
+        uint64_t key = keyOf(strategyId, text);
+        Shard& shard = shardOf(key);
+        std::unique_lock<std::shared_mutex> guard(shard.lock);
+
+        // Same key already present (another thread got here first, or a hash collision): overwrite it
+        auto it = shard.index.find(key);
+        size_t victim;
+        if (it != shard.index.end()) {
+            victim = it->second;
+        }
+        else {
+            while (shard.slots[shard.hand].referenced.exchange(false, std::memory_order_relaxed))
+                shard.hand = (shard.hand + 1) % shard.slots.size();
+            victim = shard.hand;
+            shard.hand = (shard.hand + 1) % shard.slots.size();
+            if (shard.slots[victim].result)
+                shard.index.erase(shard.slots[victim].key);
+            shard.index.emplace(key, victim);
+        }
+
+        Slot& slot = shard.slots[victim];
+        slot.key = key;
+        slot.strategyId = strategyId;
+        slot.input.assign(text);
+        slot.result = std::move(result);
+        slot.referenced.store(false, std::memory_order_relaxed);
+    }
+
+    // Drops every entry; the counters are kept
+    void clear() {
+        for (Shard& shard : shards) {
+            std::unique_lock<std::shared_mutex> guard(shard.lock);
+            shard.index.clear();
+            for (Slot& slot : shard.slots) {
+                slot.result.reset();
+                slot.input.clear();
+                slot.referenced.store(false, std::memory_order_relaxed);
+            }
+            shard.hand = 0;
+        }
+    }
+
+    size_t capacity() const { return shardCount * shards[0].slots.size(); }
+
+    size_t hits() const {
+        size_t total = 0;
+        for (const Shard& shard : shards) total += shard.hits.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    size_t misses() const {
+        size_t total = 0;
+        for (const Shard& shard : shards) total += shard.misses.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct Slot {
+        uint64_t key = 0;
+        uint64_t strategyId = 0;
+        std::string input;
+        std::shared_ptr<const std::string> result; // nullptr while the slot is empty
+        std::atomic<bool> referenced{false};
+    };
+
+    // Each shard sits on its own cache lines, so counters of neighbouring shards do not false-share
+    struct alignas(64) Shard {
+        std::shared_mutex lock;
+        std::vector<Slot> slots;
+        std::unordered_map<uint64_t, size_t> index; // key -> slot
+        size_t hand = 0;
+        std::atomic<size_t> hits{0};
+        std::atomic<size_t> misses{0};
+    };
+
+    Shard shards[shardCount];
+
+    static uint64_t keyOf(uint64_t strategyId, std::string_view text) {
+        uint64_t h = std::hash<std::string_view>{}(text);
+        return h ^ (strategyId * 0x9E3779B97F4A7C15ull);
+    }
+
+    Shard& shardOf(uint64_t key) { return shards[(key >> 32) % shardCount]; }
+};
+
+// Instrumentation: per-strategy call counts, bytes, allocations and latency histograms
+// Educational Walkthrough Notes:
+// - Compiled in only with -DTEXTFORMATTER_WITH_METRICS; otherwise CallScope is an empty inline
+//   class and every hook in TextProcessor compiles to nothing, so a normal build pays zero
+// - Each thread writes its own block of counters (relaxed load + store, no atomic read-modify-
+//   write and no lock), and readers sum the blocks of all threads, so recording never contends
+// - Strategies are identified by ITextFormatter::name(); the name is resolved to a small slot
+//   index once, in setFormatter(), so the hot path indexes an array
+// - Latency buckets are HDR-style log-linear: two sub-buckets per power of two nanoseconds,
+//   so each bucket spans at most half an octave, from 1 ns up to about 36 minutes
+// - Allocations counts the heap buffers the processor had to create for results (strings that
+//   outgrew their small-string buffer or their previous capacity)
+// - prometheusText() renders everything in the Prometheus/OpenMetrics text exposition format
+namespace metrics {
+
+#if defined(TEXTFORMATTER_WITH_METRICS)
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+inline constexpr size_t maxStrategies = 32;
+inline constexpr size_t bucketCount = 2 + 2 * 40;
+
+// Log-linear bucket of a latency: values 0 and 1 get their own buckets, then two per octave
+inline size_t bucketOf(uint64_t ns) {
+    if (ns < 2)
+        return static_cast<size_t>(ns);
+    size_t octave = static_cast<size_t>(std::bit_width(ns)) - 1;
+    size_t half = static_cast<size_t>((ns >> (octave - 1)) & 1);
+    return std::min(bucketCount - 1, 2 + (octave - 1) * 2 + half);
+}
+
+// Exclusive upper bound (in ns) of bucket b
+inline uint64_t bucketLimit(size_t b) {
+    if (b < 2)
+        return b + 1;
+    size_t octave = (b - 2) / 2 + 1;
+    return (uint64_t(1) << octave) + ((b - 2) % 2 + 1) * (uint64_t(1) << (octave - 1));
+}
+
+struct StrategyCounters {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> bytesIn{0};
+    std::atomic<uint64_t> bytesOut{0};
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> latencySumNs{0};
+    std::atomic<uint64_t> latency[bucketCount] = {};
+};
+
+// Only the owning thread writes, so a relaxed load + store is enough (no lock prefix)
+inline void bump(std::atomic<uint64_t>& counter, uint64_t by) {
+    counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+struct ThreadBlock {
+    StrategyCounters strategies[maxStrategies];
+};
+
+class Registry {
+public:
+    static Registry& global() {
+        static Registry registry;
+        return registry;
+    }
+
+    // Slot of a strategy name; called when a strategy is assigned, never per call
+    // Names beyond maxStrategies share the last slot, labeled "other"
+    unsigned slotFor(std::string_view strategy) {
+        std::lock_guard<std::mutex> guard(lock);
+        for (size_t i = 0; i < names.size(); ++i)
+            if (names[i] == strategy)
+                return static_cast<unsigned>(i);
+        if (names.size() + 1 >= maxStrategies) {
+            names.resize(maxStrategies, "other");
+            return maxStrategies - 1;
+        }
+        names.emplace_back(strategy);
+        return static_cast<unsigned>(names.size() - 1);
+    }
+
+    // This thread's counters; the block is created and registered on the thread's first call
+    // Blocks outlive their threads, so totals keep the work of threads that have exited
+    ThreadBlock& local() {
+        thread_local ThreadBlock* block = nullptr;
+        if (!block) {
+            auto owned = std::make_unique<ThreadBlock>();
+            block = owned.get();
+            std::lock_guard<std::mutex> guard(lock);
+            blocks.push_back(std::move(owned));
+        }
+        return *block;
+    }
+
+    std::string prometheusText() {
+        std::lock_guard<std::mutex> guard(lock);
+        std::string out;
+        auto sum = [&](size_t slot, auto member) {
+            uint64_t total = 0;
+            for (const auto& b : blocks) total += member(b->strategies[slot]).load(std::memory_order_relaxed);
+            return total;
+        };
+        auto label = [&](size_t slot) { return "{strategy=\"" + names[slot] + "\""; };
+        auto counter = [&](const char* metric, const char* help, auto member) {
+            out += std::string("# HELP ") + metric + " " + help + "\n# TYPE " + metric + " counter\n";
+            for (size_t slot = 0; slot < names.size(); ++slot)
+                out += metric + label(slot) + "} " + std::to_string(sum(slot, member)) + "\n";
+        };
+        counter("textformatter_calls_total", "Formatting calls per strategy.",
+                [](StrategyCounters& c) -> auto& { return c.calls; });
+        counter("textformatter_bytes_in_total", "Input bytes formatted per strategy.",
+                [](StrategyCounters& c) -> auto& { return c.bytesIn; });
+        counter("textformatter_bytes_out_total", "Output bytes produced per strategy.",
+                [](StrategyCounters& c) -> auto& { return c.bytesOut; });
+        counter("textformatter_allocations_total", "Result buffers allocated per strategy.",
+                [](StrategyCounters& c) -> auto& { return c.allocations; });
+
+        const char* metric = "textformatter_call_duration_seconds";
+        out += std::string("# HELP ") + metric + " Latency of formatting calls per strategy.\n";
+        out += std::string("# TYPE ") + metric + " histogram\n";
+        for (size_t slot = 0; slot < names.size(); ++slot) {
+            uint64_t cumulative = 0;
+            size_t last = 0;
+            for (size_t b = 0; b < bucketCount; ++b)
+                if (sum(slot, [b](StrategyCounters& c) -> auto& { return c.latency[b]; }))
+                    last = b;
+            for (size_t b = 0; b <= last; ++b) {
+                cumulative += sum(slot, [b](StrategyCounters& c) -> auto& { return c.latency[b]; });
+                char le[32];
+                // Prometheus bounds are inclusive: the largest whole nanosecond inside bucket b
+                snprintf(le, sizeof(le), "%.9g", double(bucketLimit(b) - 1) * 1e-9);
+                out += std::string(metric) + "_bucket" + label(slot) + ",le=\"" + le + "\"} "
+                    + std::to_string(cumulative) + "\n";
+            }
+            uint64_t calls = sum(slot, [](StrategyCounters& c) -> auto& { return c.calls; });
+            char seconds[32];
+            snprintf(seconds, sizeof(seconds), "%.9g",
+                     double(sum(slot, [](StrategyCounters& c) -> auto& { return c.latencySumNs; })) * 1e-9);
+            out += std::string(metric) + "_bucket" + label(slot) + ",le=\"+Inf\"} " + std::to_string(calls) + "\n";
+            out += std::string(metric) + "_sum" + label(slot) + "} " + seconds + "\n";
+            out += std::string(metric) + "_count" + label(slot) + "} " + std::to_string(calls) + "\n";
+        }
+        out += "# EOF\n";
+        return out;
+    }
+
+private:
+    std::mutex lock;
+    std::vector<std::string> names;
+    std::vector<std::unique_ptr<ThreadBlock>> blocks;
+};
+
+#if defined(TEXTFORMATTER_WITH_METRICS)
+// Records one call: construction starts the clock, done() adds the output side, and the
+// destructor files everything under the strategy's slot in this thread's block
+class CallScope {
+public:
+    CallScope(unsigned slot, size_t bytesIn)
+        : counters(Registry::global().local().strategies[slot]), in(bytesIn),
+          start(std::chrono::steady_clock::now()) {}
+
+    void done(size_t bytesOut, size_t allocated = 0) {
+        out = bytesOut;
+        allocations = allocated;
+    }
+
+    ~CallScope() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        uint64_t elapsed = ns > 0 ? uint64_t(ns) : 0;
+        bump(counters.calls, 1);
+        bump(counters.bytesIn, in);
+        bump(counters.bytesOut, out);
+        bump(counters.allocations, allocations);
+        bump(counters.latencySumNs, elapsed);
+        bump(counters.latency[bucketOf(elapsed)], 1);
+    }
+
+    CallScope(const CallScope&) = delete;
+    CallScope& operator=(const CallScope&) = delete;
+
+private:
+    StrategyCounters& counters;
+    size_t in;
+    size_t out = 0;
+    size_t allocations = 0;
+    std::chrono::steady_clock::time_point start;
+};
+
+inline unsigned slotFor(std::string_view strategy) { return Registry::global().slotFor(strategy); }
+inline std::string prometheusText() { return Registry::global().prometheusText(); }
+#else
+// Disabled build: empty inline members, so every hook vanishes at -O1 and above
+class CallScope {
+public:
+    CallScope(unsigned, size_t) {}
+    void done(size_t, size_t = 0) {}
+};
+
+inline unsigned slotFor(std::string_view) { return 0; }
+inline std::string prometheusText() { return "# EOF\n"; }
+#endif
+
+} // namespace metrics
+
+// io_uring Submission Ring (Linux): batched file I/O for formatDirectory()
+// Educational Walkthrough Notes:
+// - Formatting thousands of small files is dominated by syscalls, not by formatting: every file
+//   costs an open, a read, an open, a write and two closes
+// - io_uring replaces those calls with entries in a ring buffer shared with the kernel; one
+//   io_uring_enter() submits a whole batch of operations and waits for any of them to complete,
+//   so many files can be in flight at once for a handful of syscalls
+// - The ring is driven through the raw system calls and <linux/io_uring.h>, so no library is
+//   needed; liburing would only wrap the same three calls and the mmap()ed ring layout
+// - The application owns the submission tail and the completion head; the kernel owns the other
+//   two indices, so each side publishes its index with a release store and reads the other one
+//   with an acquire load (std::atomic_ref on the shared words)
+// - Registered ("fixed") buffers are pinned once with io_uring_register(), which saves the kernel
+//   from mapping the user pages again for every read and write that uses them
+// - Ring::create() probes the running kernel and returns nullptr when io_uring, or one of the
+//   opcodes used here, is unavailable (old kernel, seccomp filter), so callers can fall back
+enum class BulkBackend { automatic, ioUring, threadPool };
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+namespace io_ring {
+
+class Ring {
+public:
+    // Returns nullptr when io_uring or any opcode used by formatDirectory() is unavailable
+    static std::unique_ptr<Ring> create(unsigned entries) {
+        io_uring_params params{};
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0)
+            return nullptr;
+        std::unique_ptr<Ring> ring(new Ring(fd));
+        if (!ring->map(params) || !ring->supportsOpcodes())
+            return nullptr;
+        return ring;
+    }
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+        if (cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+        if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+        close(fd);
+    }
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    // Pins 'count' buffers for IORING_OP_READ_FIXED / IORING_OP_WRITE_FIXED; false if refused
+    // (typically RLIMIT_MEMLOCK on older kernels), in which case plain reads and writes are used
+    bool registerBuffers(const iovec* buffers, unsigned count) {
+        return syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, buffers, count) == 0;
+    }
+
+    // Queues one operation; the caller fills in the opcode-specific fields of the returned entry
+    // The caller keeps at most 'entries' operations in flight, so the queue never overflows
+    io_uring_sqe& prepare(unsigned char opcode, int targetFd, uint64_t userData) {
+        unsigned tail = *sqTail;
+        unsigned index = tail & *sqMask;
+        io_uring_sqe& sqe = sqes[index];
+        sqe = io_uring_sqe{};
+        sqe.opcode = opcode;
+        sqe.fd = targetFd;
+        sqe.user_data = userData;
+        sqArray[index] = index;
+        std::atomic_ref<unsigned>(*sqTail).store(tail + 1, std::memory_order_release);
+        ++unsubmitted;
+        return sqe;
+    }
+
+    // Submits everything queued and waits until at least one completion is available
+    void submitAndWait() {
+        for (;;) {
+            long n = syscall(__NR_io_uring_enter, fd, unsubmitted, 1u, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (n >= 0) {
+                unsubmitted -= static_cast<unsigned>(n);
+                return;
+            }
+            if (errno != EINTR)
+                throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+        }
+    }
+
+    // Calls handler(userData, result) for every completion that has arrived
+    // The handler may prepare() new operations; they are submitted by the next submitAndWait()
+    template<typename Handler>
+    void drain(Handler&& handler) {
+        unsigned head = *cqHead;
+        unsigned tail = std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire);
+        while (head != tail) {
+            const io_uring_cqe& cqe = cqes[head & *cqMask];
+            uint64_t userData = cqe.user_data;
+            int result = cqe.res;
+            // Hand the entry back before running the handler, which may queue more work
+            std::atomic_ref<unsigned>(*cqHead).store(++head, std::memory_order_release);
+            handler(userData, result);
+            tail = std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire);
+        }
+    }
+
+private:
+    explicit Ring(int fd) : fd(fd) {}
+
+    bool map(const io_uring_params& params) {
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single)
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED)
+            return false;
+        cqRing = single ? sqRing
+                        : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED)
+            return false;
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED)
+            return false;
+
+        auto field = [](void* base, unsigned offset) {
+            return reinterpret_cast<unsigned*>(static_cast<char*>(base) + offset);
+        };
+        sqTail = field(sqRing, params.sq_off.tail);
+        sqMask = field(sqRing, params.sq_off.ring_mask);
+        sqArray = field(sqRing, params.sq_off.array);
+        cqHead = field(cqRing, params.cq_off.head);
+        cqTail = field(cqRing, params.cq_off.tail);
+        cqMask = field(cqRing, params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(cqRing) + params.cq_off.cqes);
+        return true;
+    }
+
+    // openat/close through the ring need Linux 5.6; the probe itself fails on older kernels
+    bool supportsOpcodes() {
+        constexpr unsigned opCount = 64;
+        alignas(io_uring_probe) unsigned char storage[sizeof(io_uring_probe) + opCount * sizeof(io_uring_probe_op)] = {};
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage);
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, opCount) != 0)
+            return false;
+        for (unsigned op : {IORING_OP_OPENAT, IORING_OP_CLOSE, IORING_OP_READ, IORING_OP_WRITE,
+                            IORING_OP_READ_FIXED, IORING_OP_WRITE_FIXED}) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+                return false;
+        }
+        return true;
+    }
+
+    int fd;
+    void* sqRing = MAP_FAILED;
+    void* cqRing = MAP_FAILED;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqRingSize = 0, cqRingSize = 0, sqesSize = 0;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned unsubmitted = 0;
+};
+
+} // namespace io_ring
+#define TEXTFORMATTER_HAS_IO_URING 1
+#endif
+
+// Context Class: manages and applies a selected formatting strategy
+// Educational Walkthrough Notes:
+// - This class holds a smart pointer (unique_ptr) to the ITextFormatter interface
+// - Using unique_ptr expresses exclusive ownership: TextProcessor owns the strategy object
+// - Delegates formatting behavior to the currently assigned strategy object
+// - The strategy can be changed dynamically at runtime using setFormatter()
+// - Demonstrates the Strategy Design Pattern by decoupling formatting logic from the context
+// - The context class does not implement formatting itself; it provides the environment in which a strategy operates
+// - Supports scalability and flexibility: new strategies can be added without modifying the context
+// - Adheres to the Open/Closed Principle (open to extension, closed to modification)
+// - Uses composition (holding a strategy object) rather than inheritance, which increases flexibility
+// - Modern C++ note: smart pointers eliminate the need for manual memory management and prevent leaks
+
+class TextProcessor {
+private:
+    // Smart pointer to the current formatting strategy (implements ITextFormatter interface)
+    // A strategy handed over as a unique_ptr is owned by this TextProcessor alone; shared_ptr also
+    // lets stateless strategies be shared singletons (see FormatterRegistry)
+    // When the TextProcessor object is destroyed or a new strategy is assigned, the old strategy
+    // is automatically cleaned up once its last owner lets go
+    std::shared_ptr<ITextFormatter> formatter;
+
+    // Parallel engine state
+    // The pool is created lazily on the first parallel call, so sequential users never start threads
+    unsigned threadCount = 0;
+    std::unique_ptr<ThreadPool> pool;
+
+    // Topology-aware scheduling (see setTopologyAware()): workerNodes[i] is the node (index into
+    // topology::current().nodes) that worker i is pinned to
+    bool topologyAware = false;
+    std::vector<size_t> workerNodes;
+    std::vector<topology::NodeThroughput> lastNodeThroughput;
+
+    // GPU offload (see setGpuOffload()): inputs of at least gpuThreshold bytes go to the device;
+    // 0 disables it. gpuBytes counts what the device formatted
+    size_t gpuThreshold = gpu::defaultOffloadThreshold;
+    size_t gpuBytes = 0;
+
+    // Memory resource used by formatPmr()/formatView(); never owned by the processor
+    std::pmr::memory_resource* resource;
+
+    // Optional result cache (shared so several processors, e.g. one per thread, can use one cache)
+    // strategyId identifies the current strategy inside the cache keys; 0 means "no strategy"
+    std::shared_ptr<FormatCache> cache;
+    uint64_t strategyId = 0;
+
+    static uint64_t nextStrategyId() {
+        static std::atomic<uint64_t> counter{0};
+        return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    bool cacheable(std::string_view text) const {
+        return cache && formatter && text.size() <= maxCachedLength;
+    }
+
+    // Metrics slot of the current strategy (see namespace metrics); resolved in setFormatter()
+    unsigned metricsSlot = 0;
+
+    void assignMetricsSlot() {
+        if constexpr (metrics::enabled)
+            metricsSlot = metrics::slotFor(formatter ? formatter->name() : "none");
+    }
+
+    static size_t totalSize(std::span<const std::string_view> inputs) {
+        size_t total = 0;
+        for (std::string_view s : inputs) total += s.size();
+        return total;
+    }
+
+    // Formats 'text' in place, a slice at a time, checking for cancellation between slices
+    // (all of the async entry points end up here)
+    static void formatCancellable(ITextFormatter* f, std::string& text, const std::stop_token& stop) {
+        auto checkCancelled = [&] {
+            if (stop.stop_requested())
+                throw std::system_error(std::make_error_code(std::errc::operation_canceled), "TextProcessor::formatAsync");
+        };
+        checkCancelled();
+        if (!f)
+            return;
+        if (!f->supportsChunking() || !f->isLengthPreserving()) {
+            f->formatInPlace(text);
+            return;
+        }
+        char preceding = ' ';
+        for (size_t begin = 0; begin < text.size(); begin += asyncSliceSize) {
+            checkCancelled();
+            size_t n = std::min(asyncSliceSize, text.size() - begin);
+            char last = text[begin + n - 1];
+            f->formatChunk(std::span<char>(text).subspan(begin, n), preceding);
+            preceding = last;
+        }
+    }
+
+    // Number of heap buffers a string acquired between two capacity readings
+    static size_t allocatedBetween(size_t capacityBefore, size_t capacityAfter) {
+        return capacityAfter > capacityBefore ? 1 : 0;
+    }
+
+    // The cache lookup behind format() and formatCached() (cacheable inputs only); no metrics
+    // here, the callers record the call
+    std::shared_ptr<const std::string> cachedResult(std::string_view text, bool* hit = nullptr) {
+        if (auto stored = cache->find(strategyId, text)) {
+            if (hit) *hit = true;
+            return stored;
+        }
+        std::string result(text);
+        formatter->formatInPlace(result);
+        auto stored = std::make_shared<const std::string>(std::move(result));
+        cache->insert(strategyId, text, stored);
+        return stored;
+    }
+
+    ThreadPool& threadPool() {
+        if (!pool && topologyAware)
+            pool = std::make_unique<ThreadPool>(topologyCpus());
+        if (!pool)
+            pool = std::make_unique<ThreadPool>(threadCount);
+        return *pool;
+    }
+
+    // CPUs for a topology-aware pool: taken round-robin across the nodes (so even a small pool
+    // uses every socket's memory controller), then grouped by node so that neighbouring queues,
+    // the first ones a worker steals from, are on its own node; fills workerNodes to match
+    std::vector<unsigned> topologyCpus() {
+        const topology::Topology& topo = topology::current();
+        unsigned count = threadCount == 0 ? topo.cpuCount() : threadCount;
+        std::vector<std::vector<unsigned>> picked(topo.nodes.size());
+        for (unsigned k = 0, taken = 0; taken < count; ++k) {
+            for (size_t n = 0; n < topo.nodes.size() && taken < count; ++n) {
+                const std::vector<unsigned>& cpus = topo.nodes[n].cpus;
+                picked[n].push_back(cpus[k % cpus.size()]);
+                ++taken;
+            }
+        }
+        std::vector<unsigned> cpus;
+        workerNodes.clear();
+        for (size_t n = 0; n < picked.size(); ++n) {
+            cpus.insert(cpus.end(), picked[n].begin(), picked[n].end());
+            workerNodes.insert(workerNodes.end(), picked[n].size(), n);
+        }
+        return cpus;
+    }
+
+    // True when the topology-aware pool has workers on more than one node
+    bool spansNodes() const {
+        return std::adjacent_find(workerNodes.begin(), workerNodes.end(), std::not_equal_to<>()) != workerNodes.end();
+    }
+
+    // Topology-aware split of formatRange()
+    // Educational note:
+    // - Chunks are half an L2 cache (input and output of one chunk fit in L2 together) and start
+    //   on page boundaries of the destination, so no page is shared by two workers: the worker that
+    //   writes a fresh output page first is the one whose node the kernel places it on
+    // - Each chunk's home node is where its input page already lives (topology::pageNodes); input
+    //   the kernel cannot place (not yet touched, no NUMA) is dealt out in contiguous blocks, one
+    //   per node with workers, so the output pages are first-touched node by node as well
+    // - Every node gets one list of chunks with an atomic cursor; each worker drains its own node's
+    //   list first and only then helps other nodes, and that remote work is what remoteBytes counts
+    template <typename Piece>
+    void formatRangeByNode(std::string_view source, std::span<char> dest, const Piece& formatPiece) {
+        using Clock = std::chrono::steady_clock;
+        const topology::Topology& topo = topology::current();
+        ThreadPool& workers = threadPool();
+        size_t nodeCount = topo.nodes.size();
+        size_t page = topo.pageSize;
+        size_t chunkSize = std::max(page, topo.l2CacheSize / 2 / page * page);
+
+        std::vector<size_t> bounds{0};
+        if (size_t head = (page - reinterpret_cast<uintptr_t>(dest.data()) % page) % page)
+            bounds.push_back(head);
+        for (size_t b = bounds.back() + chunkSize; b < source.size(); b += chunkSize)
+            bounds.push_back(b);
+        bounds.push_back(source.size());
+        size_t chunkCount = bounds.size() - 1;
+
+        std::vector<const void*> probes(chunkCount);
+        std::vector<char> preceding(chunkCount, ' ');
+        for (size_t c = 0; c < chunkCount; ++c) {
+            probes[c] = source.data() + bounds[c];
+            if (c > 0) preceding[c] = source[bounds[c] - 1];
+        }
+        std::vector<int> located = topology::pageNodes(probes);
+
+        std::vector<size_t> activeNodes;
+        for (size_t n = 0; n < nodeCount; ++n) {
+            if (std::find(workerNodes.begin(), workerNodes.end(), n) != workerNodes.end())
+                activeNodes.push_back(n);
+        }
+        if (activeNodes.empty())
+            activeNodes.push_back(0);
+        std::vector<std::vector<size_t>> chunksOf(nodeCount);
+        for (size_t c = 0; c < chunkCount; ++c) {
+            size_t home = topo.indexOfNode(located[c]);
+            if (home >= nodeCount)
+                home = activeNodes[c * activeNodes.size() / chunkCount];
+            chunksOf[home].push_back(c);
+        }
+
+        struct alignas(64) Cursor { std::atomic<size_t> next{0}; };
+        std::vector<Cursor> cursors(nodeCount);
+        std::vector<topology::NodeThroughput> report(nodeCount);
+        std::vector<Clock::time_point> firstStart(nodeCount, Clock::time_point::max());
+        std::vector<Clock::time_point> lastEnd(nodeCount, Clock::time_point::min());
+        std::mutex reportLock;
+
+        std::vector<size_t> placement(workers.size());
+        for (size_t w = 0; w < placement.size(); ++w) placement[w] = w;
+        workers.runAllOn(placement, [&](size_t w) {
+            size_t own = w < workerNodes.size() ? workerNodes[w] : 0;
+            size_t running = topology::currentNode();
+            size_t bytes = 0, remote = 0;
+            Clock::time_point start = Clock::now();
+            for (size_t n = 0; n < nodeCount; ++n) {
+                size_t from = (own + n) % nodeCount;
+                const std::vector<size_t>& list = chunksOf[from];
+                for (size_t k; (k = cursors[from].next.fetch_add(1, std::memory_order_relaxed)) < list.size();) {
+                    size_t c = list[k], length = bounds[c + 1] - bounds[c];
+                    formatPiece(bounds[c], length, preceding[c]);
+                    bytes += length;
+                    if (located[c] >= 0 && from != running) remote += length;
+                }
+            }
+            if (bytes == 0)
+                return;
+            Clock::time_point end = Clock::now();
+            std::lock_guard<std::mutex> guard(reportLock);
+            report[running].bytes += bytes;
+            report[running].remoteBytes += remote;
+            firstStart[running] = std::min(firstStart[running], start);
+            lastEnd[running] = std::max(lastEnd[running], end);
+        });
+
+        for (size_t n = 0; n < nodeCount; ++n) {
+            report[n].node = topo.nodes[n].id;
+            report[n].workers = static_cast<unsigned>(std::count(workerNodes.begin(), workerNodes.end(), n));
+            if (report[n].bytes > 0)
+                report[n].seconds = std::chrono::duration<double>(lastEnd[n] - firstStart[n]).count();
+        }
+        lastNodeThroughput = std::move(report);
+    }
+
+    // GPU offload of formatRange() (see setGpuOffload())
+    // Only upper/lower/title with the "C" tables qualify: locale tables live in host memory and
+    // user strategies have no device code; a failed transfer leaves the range to the CPU path,
+    // which may simply run over a half-written in-place buffer because the operations are idempotent
+    bool offloadToGpu(std::string_view source, std::span<char> dest) {
+        if (gpuThreshold == 0 || source.size() < gpuThreshold)
+            return false;
+        auto* caseFormatter = dynamic_cast<BytewiseCaseFormatter*>(formatter.get());
+        if (!caseFormatter || !caseFormatter->hasAsciiTables() || !gpu::available())
+            return false;
+        if (!gpu::transform(caseFormatter->caseOp(), source.data(), dest.data(), source.size(), ' '))
+            return false;
+        gpuBytes += source.size();
+        return true;
+    }
+
+    // Formats 'source' into 'dest' (same length; the two may be the very same buffer)
+    // Educational note:
+    // - When the buffers differ and the strategy isBytewise(), each chunk is formatted straight
+    //   from source to dest in one pass (formatChunkInto); for other strategies the copy is done
+    //   tile by tile and each tile is formatted right after it is copied, while it is still in L1/L2
+    // - With 'parallel' set, large inputs are split into chunks on the thread pool; the byte
+    //   preceding each chunk is captured before any task starts, because in the in-place case a
+    //   neighbouring task may be rewriting that byte while this chunk is formatted
+    // - Inputs of at least gpuThreshold bytes first go to the GPU backend when the strategy has a
+    //   device equivalent; if the device cannot take the job the range is formatted here as usual
+    void formatRange(std::string_view source, std::span<char> dest, bool parallel) {
+        if (offloadToGpu(source, dest))
+            return;
+        bool inPlace = source.data() == dest.data();
+        bool bytewise = formatter->isBytewise();
+        if (!formatter->supportsChunking()) {
+            if (!inPlace) memcpy(dest.data(), source.data(), source.size());
+            formatter->formatSpan(dest);
+            return;
+        }
+
+        auto formatPiece = [&](size_t begin, size_t length, char preceding) {
+            if (inPlace) {
+                formatter->formatChunk(dest.subspan(begin, length), preceding);
+                return;
+            }
+            if (bytewise) {
+                formatter->formatChunkInto(source.substr(begin, length), dest.subspan(begin, length), preceding);
+                return;
+            }
+            for (size_t offset = 0; offset < length; offset += copyTileSize) {
+                size_t n = std::min(copyTileSize, length - offset);
+                memcpy(dest.data() + begin + offset, source.data() + begin + offset, n);
+                formatter->formatChunk(dest.subspan(begin + offset, n),
+                                       offset == 0 ? preceding : source[begin + offset - 1]);
+            }
+        };
+
+        if (parallel && topologyAware && source.size() >= 2 * minParallelChunk) {
+            formatRangeByNode(source, dest, formatPiece);
+            return;
+        }
+        size_t chunkCount = 1;
+        if (parallel && source.size() >= 2 * minParallelChunk)
+            chunkCount = std::min<size_t>(size_t(threadPool().size()) * 4, source.size() / minParallelChunk);
+        if (chunkCount < 2) {
+            formatPiece(0, source.size(), ' ');
+            return;
+        }
+        size_t chunkSize = (source.size() + chunkCount - 1) / chunkCount;
+        std::vector<char> preceding(chunkCount, ' ');
+        for (size_t i = 1; i < chunkCount; ++i)
+            preceding[i] = source[i * chunkSize - 1];
+        threadPool().runAll(chunkCount, [&](size_t i) {
+            size_t begin = i * chunkSize;
+            formatPiece(begin, std::min(chunkSize, source.size() - begin), preceding[i]);
+        });
+    }
+
+public:
+    // Inputs smaller than this are never split: below it, thread hand-off costs more than it saves
+    static constexpr size_t minParallelChunk = 256 * 1024;
+
+    // Granularity of the copy-then-format loop in formatRange() (strategies that are not bytewise): small enough to stay in L2
+    static constexpr size_t copyTileSize = 64 * 1024;
+
+    // Constructor initializes the formatter smart pointer to nullptr (no strategy assigned by default)
+    // unique_ptr can safely hold nullptr, representing 'no current strategy'
+    TextProcessor() : formatter(nullptr), resource(std::pmr::get_default_resource()) {}
+
+    // Builds a processor whose allocator-aware calls draw from 'r' (which must outlive it)
+    // e.g. a std::pmr::monotonic_buffer_resource per request, or an
+    // std::pmr::unsynchronized_pool_resource per thread
+    explicit TextProcessor(std::pmr::memory_resource* r) : formatter(nullptr), resource(r) {}
+
+    // Assigns a new formatting strategy at runtime
+    // Ownership of the strategy object is transferred into the context using std::move
+    // This enables dynamic selection of behavior without modifying the context class
+    // The strategy is bound to the active locale's character tables here, once, so formatting
+    // never consults the locale per character (see CaseTables)
+    void setFormatter(std::unique_ptr<ITextFormatter> f) {
+        formatter = std::move(f);
+        strategyId = formatter ? nextStrategyId() : 0;
+        if (formatter)
+            formatter->useCaseTables(CaseTables::forCurrentLocale());
+        assignMetricsSlot();
+    }
+
+    // Shares a strategy with other owners (typically a FormatterRegistry singleton) instead of
+    // taking it over; no allocation happens here
+    // Shared strategies are not rebound: other threads may be using them, so whoever created
+    // them binds the locale tables once, up front
+    // (A separate name rather than a setFormatter() overload: make_unique<Derived>() converts to
+    // both smart pointers, so the overload would be ambiguous at every existing call site)
+    void shareFormatter(std::shared_ptr<ITextFormatter> f) {
+        formatter = std::move(f);
+        strategyId = formatter ? nextStrategyId() : 0;
+        assignMetricsSlot();
+    }
+
+    // Applies the currently assigned formatting strategy to the input text
+    // If no strategy is set (formatter == nullptr), returns the original input unchanged
+    // Educational note:
+    // - 'formatter' is a smart pointer to ITextFormatter initialized to nullptr in the constructor
+    // - It is set explicitly via the public setFormatter() method, so assignment happens outside the class (in main())
+    // - Smart pointer semantics ensure safe cleanup when strategies are replaced or when TextProcessor goes out of scope
+    // When a cache is enabled, short inputs are looked up first and only formatted on a miss
+    std::string format(const std::string& text) {
+        metrics::CallScope scope(metricsSlot, text.size());
+        if (cacheable(text)) {
+            // A hit is never recomputed, but a std::string result is a copy of the stored one (one
+            // allocation past the small-string buffer); formatCached() returns the stored result
+            std::string result = *cachedResult(text);
+            scope.done(result.size(), allocatedBetween(std::string().capacity(), result.capacity()));
+            return result;
+        }
+        std::string result = formatter ? formatter->format(text) : text;
+        scope.done(result.size(), allocatedBetween(std::string().capacity(), result.capacity()));
+        return result;
+    }
+
+    // Allocation-free forwarding overloads
+    // Each one mirrors the matching ITextFormatter entry point; with no strategy assigned
+    // the text passes through unchanged, exactly like format() above
+    // Educational note:
+    // - format(string&&) lets callers write 'line = processor.format(move(line));'
+    //   and keep reusing the same heap buffer on every iteration
+    // - formatInto() writes into storage the caller already owns (a reused string or a raw span)
+    std::string format(std::string&& text) {
+        formatInPlace(text);
+        return std::move(text);
+    }
+
+    void formatInPlace(std::string& text) {
+        metrics::CallScope scope(metricsSlot, text.size());
+        size_t capacity = text.capacity();
+        if (formatter)
+            formatter->formatInPlace(text);
+        scope.done(text.size(), allocatedBetween(capacity, text.capacity()));
+    }
+
+    void formatInto(std::string_view text, std::string& out) {
+        metrics::CallScope scope(metricsSlot, text.size());
+        size_t capacity = out.capacity();
+        if (formatter)
+            formatter->formatInto(text, out);
+        else
+            out.assign(text);
+        scope.done(out.size(), allocatedBetween(capacity, out.capacity()));
+    }
+
+    size_t formatInto(std::string_view text, std::span<char> out) {
+        metrics::CallScope scope(metricsSlot, text.size());
+        size_t written;
+        if (formatter)
+            written = formatter->formatInto(text, out);
+        else if (out.size() < text.size())
+            throw std::length_error("TextProcessor::formatInto: output buffer too small");
+        else
+            written = text.copy(out.data(), text.size());
+        scope.done(written);
+        return written;
+    }
+
+    // Allocator-aware forwarding: results come from the processor's memory resource
+    // With no strategy assigned the text is copied into the resource unchanged
+    std::pmr::memory_resource* getMemoryResource() const { return resource; }
+
+    std::pmr::string formatPmr(std::string_view text) {
+        if (formatter)
+            return formatter->formatPmr(text, resource);
+        return std::pmr::string(text, resource);
+    }
+
+    std::string_view formatView(std::string_view text) {
+        if (formatter)
+            return formatter->formatView(text, *resource);
+        if (text.empty())
+            return {};
+        char* data = static_cast<char*>(resource->allocate(text.size(), alignof(char)));
+        return std::string_view(data, text.copy(data, text.size()));
+    }
+
+    // Memoization (see FormatCache)
+    // Educational note:
+    // - enableCache() gives the processor its own cache; setCache() shares one between processors
+    // - formatCached() is the zero-copy entry point: a hit hands back the stored result itself;
+    //   format(const std::string&) consults the same cache but copies the result out, which
+    //   allocates for results longer than the small-string buffer
+    // - Both record every cacheable call, hit or miss, in the strategy's metrics slot
+    // - Inputs longer than maxCachedLength bypass the cache: they rarely repeat, and storing them
+    //   would evict the short keys that do; for high-entropy streams simply call disableCache()
+    // - A hit costs a hash, a shared lock and a reference-count increment (tens of ns); the ASCII
+    //   SIMD strategies format a short token in about that time anyway, so the cache pays off
+    //   mainly for the UTF-8 strategies, pipelines and other expensive formatters
+    static constexpr size_t maxCachedLength = 1024;
+
+    void enableCache(size_t capacity = 4096) { cache = std::make_shared<FormatCache>(capacity); }
+    void setCache(std::shared_ptr<FormatCache> c) { cache = std::move(c); }
+    void disableCache() { cache.reset(); }
+    FormatCache* getCache() const { return cache.get(); }
+
+    // Processors holding equivalent strategies (e.g. one per thread) can share cached results
+    // by agreeing on an id; call this after setFormatter(), which always assigns a fresh one
+    uint64_t getStrategyId() const { return strategyId; }
+    void setStrategyId(uint64_t id) { strategyId = id; }
+
+    std::shared_ptr<const std::string> formatCached(std::string_view text) {
+        if (!cacheable(text)) {
+            std::string result(text);
+            formatInPlace(result);
+            return std::make_shared<const std::string>(std::move(result));
+        }
+        metrics::CallScope scope(metricsSlot, text.size());
+        bool hit = false;
+        std::shared_ptr<const std::string> result = cachedResult(text, &hit);
+        // A hit only shares the stored string; a miss allocated the new shared result
+        scope.done(result->size(), hit ? 0 : 1);
+        return result;
+    }
+
+    // Parallel Execution
+    // Educational Walkthrough Notes:
+    // - setThreadCount() configures the pool size (0 = one thread per hardware thread); changing it
+    //   tears down the current pool, and a new one is created on the next parallel call
+    // - The format_policy::par overloads split a large buffer into chunks when the strategy
+    //   supportsChunking(); title case stays correct because each chunk is told the byte before it
+    // - Strategies that cannot be chunked, and inputs too small to be worth it, run sequentially
+    // - The format_policy::seq overloads are the plain sequential calls, for symmetric call sites
+    // - setTopologyAware(true) makes the parallel calls NUMA- and cache-aware: workers are pinned to
+    //   CPUs spread over the nodes, input is split into L2-sized, page-aligned chunks that are
+    //   formatted on the node holding them, and output pages are first touched by the worker that
+    //   fills them (see formatRangeByNode()) in formatFile() and in formatInto() a fresh buffer, and
+    //   in format() from C++23 on; nodeThroughput() then reports each node's share
+    void setThreadCount(unsigned count) {
+        threadCount = count;
+        pool.reset();
+    }
+
+    unsigned getThreadCount() const {
+        if (threadCount != 0)
+            return threadCount;
+        return topologyAware ? topology::current().cpuCount() : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    void setTopologyAware(bool enabled) {
+        topologyAware = enabled;
+        pool.reset();
+        workerNodes.clear();
+        lastNodeThroughput.clear();
+    }
+
+    bool isTopologyAware() const { return topologyAware; }
+
+    // Routes parallel formatting of inputs of at least 'threshold' bytes to the GPU backend
+    // (upper/lower/title with the "C" tables, in a -DTEXTFORMATTER_WITH_CUDA build with a device);
+    // 0 keeps everything on the CPU. The default threshold is gpu::defaultOffloadThreshold, so large
+    // files are offloaded automatically when the backend is present; without it the check is free
+    void setGpuOffload(size_t threshold = gpu::defaultOffloadThreshold) { gpuThreshold = threshold; }
+
+    size_t gpuOffloadThreshold() const { return gpuThreshold; }
+
+    // Bytes the GPU backend has formatted for this processor so far
+    size_t gpuOffloadedBytes() const { return gpuBytes; }
+
+    // Per-node bytes, time and remote share of the last topology-aware parallel call (one entry per
+    // node with usable CPUs; empty until such a call has split its input)
+    const std::vector<topology::NodeThroughput>& nodeThroughput() const { return lastNodeThroughput; }
+
+    std::string format(format_policy::sequenced_policy, const std::string& text) { return format(text); }
+    void formatInPlace(format_policy::sequenced_policy, std::string& text) { formatInPlace(text); }
+
+    std::string format(format_policy::parallel_policy policy, const std::string& text) {
+        if (!formatter || !formatter->isBytewise()) {
+            std::string result = text;
+            formatInPlace(policy, result);
+            return result;
+        }
+        // Bytewise strategies write the result straight from 'text', without copying it in first
+        metrics::CallScope scope(metricsSlot, text.size());
+        std::string result;
+#if defined(__cpp_lib_string_resize_and_overwrite)
+        if (topologyAware && threadPool().size() > 1 && spansNodes()) {
+            // Output pages must be first touched by the workers, not by a zero fill on this thread
+            // (with a single node there is nothing to place). This needs C++23: before it a
+            // std::string cannot be sized without writing every byte, so C++20 builds take the
+            // plain path below; formatInto(par, text, span) places pages in either standard
+            result.resize_and_overwrite(text.size(), [&](char* data, size_t size) {
+                formatRange(text, std::span<char>(data, size), true);
+                return size;
+            });
+            scope.done(result.size(), allocatedBetween(std::string().capacity(), result.capacity()));
+            return result;
+        }
+#endif
+        result.assign(text.size(), '\0');
+        formatRange(text, result, true);
+        scope.done(result.size(), allocatedBetween(std::string().capacity(), result.capacity()));
+        return result;
+    }
+
+    // Parallel formatInto() a caller-provided buffer; with a freshly allocated, never written
+    // buffer (e.g. std::make_unique_for_overwrite<char[]>(n)) topology-aware mode places every
+    // output page on the node of the worker that fills it
+    size_t formatInto(format_policy::parallel_policy, std::string_view text, std::span<char> out) {
+        if (!formatter || !formatter->isLengthPreserving() || !formatter->supportsChunking())
+            return formatInto(text, out);
+        if (out.size() < text.size())
+            throw std::length_error("TextProcessor::formatInto: output buffer too small");
+        metrics::CallScope scope(metricsSlot, text.size());
+        formatRange(text, out.first(text.size()), true);
+        scope.done(text.size());
+        return text.size();
+    }
+
+    void formatInPlace(format_policy::parallel_policy, std::span<char> text) {
+        if (!formatter)
+            return;
+        metrics::CallScope scope(metricsSlot, text.size());
+        formatRange(std::string_view(text.data(), text.size()), text, true);
+        scope.done(text.size());
+    }
+
+    // Length-changing strategies cannot be split into fixed-size chunks; they run sequentially
+    void formatInPlace(format_policy::parallel_policy policy, std::string& text) {
+        if (formatter && !formatter->isLengthPreserving())
+            formatInPlace(text);
+        else
+            formatInPlace(policy, std::span<char>(text));
+    }
+
+    void formatBatch(format_policy::sequenced_policy, std::span<const std::string_view> inputs, FormattedBatch& out) {
+        formatBatch(inputs, out);
+    }
+
+    // Parallel batches are cut into slices of roughly equal byte counts, and each slice is one
+    // formatSegments() call on the work-stealing pool
+    void formatBatch(format_policy::parallel_policy, std::span<const std::string_view> inputs, FormattedBatch& out) {
+        if (formatter && !formatter->isLengthPreserving()) {
+            formatBatch(inputs, out);
+            return;
+        }
+        metrics::CallScope scope(metricsSlot, totalSize(inputs));
+        size_t capacity = out.data.capacity();
+        out.pack(inputs);
+        scope.done(out.data.size(), allocatedBetween(capacity, out.data.capacity()));
+        if (!formatter || out.size() == 0)
+            return;
+        ThreadPool& workers = threadPool();
+        size_t sliceCount = std::min<size_t>(size_t(workers.size()) * 4, out.size());
+        if (out.data.size() < 2 * minParallelChunk || sliceCount < 2) {
+            formatter->formatSegments(out, 0, out.size());
+            return;
+        }
+        size_t bytesPerSlice = out.data.size() / sliceCount + 1;
+        std::vector<size_t> bounds{0};
+        for (size_t i = 1; i < out.size(); ++i) {
+            if (out.offsets[i] - out.offsets[bounds.back()] >= bytesPerSlice)
+                bounds.push_back(i);
+        }
+        bounds.push_back(out.size());
+        workers.runAll(bounds.size() - 1, [&](size_t i) {
+            formatter->formatSegments(out, bounds[i], bounds[i + 1]);
+        });
+    }
+
+    // Formats a string column (offsets + data + validity, see namespace columnar) with the current
+    // strategy; with no strategy assigned the rows are copied unchanged and the offsets reused
+    template <typename Offset>
+    void formatColumn(const columnar::StringColumnView<Offset>& column, columnar::FormattedColumn<Offset>& out) {
+        size_t begin = column.rows() ? columnar::checkedOffset(column.offsets.front()) : 0;
+        size_t end = column.rows() ? columnar::checkedOffset(column.offsets.back()) : 0;
+        metrics::CallScope scope(metricsSlot, end - begin);
+        if (formatter) {
+            columnar::formatColumn(*formatter, column, out);
+        }
+        else {
+            out.offsets.clear();
+            out.offsetsReused = true;
+            out.data.assign(end, '\0');
+            if (end > begin) memcpy(out.data.data() + begin, column.data + begin, end - begin);
+        }
+        scope.done(out.data.size());
+    }
+
+    // Formats a whole batch with a single call into the strategy
+    // With no strategy assigned the inputs are packed unchanged
+    void formatBatch(std::span<const std::string_view> inputs, FormattedBatch& out) {
+        metrics::CallScope scope(metricsSlot, totalSize(inputs));
+        size_t capacity = out.data.capacity();
+        if (formatter)
+            formatter->formatBatch(inputs, out);
+        else
+            out.pack(inputs);
+        scope.done(out.data.size(), allocatedBetween(capacity, out.data.capacity()));
+    }
+
+    // Chunk-level forwarding, used by the streaming mode to format one block at a time
+    // With no strategy assigned every input can trivially be chunked (it passes through unchanged)
+    bool supportsChunking() const {
+        return !formatter || formatter->supportsChunking();
+    }
+
+    void formatChunk(std::span<char> chunk, char preceding) {
+        metrics::CallScope scope(metricsSlot, chunk.size());
+        if (formatter)
+            formatter->formatChunk(chunk, preceding);
+        scope.done(chunk.size());
+    }
+
+    // Incremental Re-formatting
+    // Educational Walkthrough Notes:
+    // - An editor changes a few characters of a large document; formatting the whole document
+    //   again after every keystroke costs time proportional to the document, not to the edit
+    // - formatEdit() takes the previous input and its formatted output, applies the edit
+    //   (replace 'length' bytes at 'offset' with 'replacement') to both, and re-formats only
+    //   the bytes whose result can have changed
+    // - The chunking contract already says how far that is: a chunkable strategy's output for a
+    //   byte depends only on that byte and the one before it, so only the replacement itself and
+    //   the single byte after it need work (title case's 'capitalize' flag is exactly "the
+    //   previous byte was whitespace", which is why no wider word boundary has to be found)
+    // - Strategies that cannot be chunked, or that change the length, re-format everything
+    // - Same-length edits touch nothing else; edits that change the length still shift the tail
+    //   of both strings (a memmove), which is far cheaper than formatting it again
+    // Returns the number of bytes that were re-formatted
+    size_t formatEdit(std::string& input, std::string& output, size_t offset, size_t length,
+                      std::string_view replacement) {
+        if (offset > input.size())
+            throw std::out_of_range("TextProcessor::formatEdit: edit offset past the end of the input");
+        length = std::min(length, input.size() - offset);
+        bool incremental = !formatter
+            || (formatter->supportsChunking() && formatter->isLengthPreserving() && output.size() == input.size());
+        input.replace(offset, length, replacement);
+        if (!incremental) {
+            formatInto(input, output);
+            return input.size();
+        }
+        output.replace(offset, length, replacement);
+        if (!formatter)
+            return 0;
+
+        // The replacement plus the one byte after it (its preceding byte may have changed)
+        size_t end = std::min(offset + replacement.size() + 1, input.size());
+        std::copy(input.begin() + std::ptrdiff_t(offset), input.begin() + std::ptrdiff_t(end),
+                  output.begin() + std::ptrdiff_t(offset));
+        formatter->formatChunk(std::span<char>(output).subspan(offset, end - offset),
+                               offset > 0 ? input[offset - 1] : ' ');
+        return end - offset;
+    }
+
+    // Chunked output: formats 'text' a tile at a time into a small stack buffer and hands each
+    // formatted piece to 'sink' (any callable taking std::string_view), so the result can be
+    // hashed or written to a socket without ever being materialized as a whole
+    // Strategies that cannot be chunked, or that change the length, are formatted in one piece
+    template <typename Sink>
+    void formatTo(std::string_view text, Sink&& sink) {
+        if (!formatter) {
+            sink(text);
+            return;
+        }
+        if (!formatter->supportsChunking() || !formatter->isLengthPreserving()) {
+            std::string result(text);
+            formatter->formatInPlace(result);
+            sink(std::string_view(result));
+            return;
+        }
+        char tile[4096];
+        char preceding = ' ';
+        for (size_t begin = 0; begin < text.size(); begin += sizeof(tile)) {
+            size_t n = std::min(sizeof(tile), text.size() - begin);
+            text.copy(tile, n, begin);
+            formatter->formatChunk(std::span<char>(tile, n), preceding);
+            preceding = text[begin + n - 1];
+            sink(std::string_view(tile, n));
+        }
+    }
+
+    // Asynchronous Formatting
+    // Educational Walkthrough Notes:
+    // - An event loop that calls format() on a multi-megabyte payload stalls every other
+    //   connection for milliseconds; the async entry points move such jobs off the calling thread
+    // - Inputs smaller than asyncInlineThreshold are formatted inline, right away: handing them to
+    //   another thread would cost more than the work itself
+    // - Larger inputs run on the processor's work-stealing pool, in slices of asyncSliceSize, and
+    //   the stop_token is checked between slices; a cancelled job ends with std::system_error
+    //   (std::errc::operation_canceled) instead of a result
+    // - Three shapes of the same operation:
+    //   * co_await processor.formatAsync(std::move(text), stop) inside a C++20 coroutine; after a
+    //     background job the coroutine resumes on the pool thread, so a loop that wants its
+    //     continuation back on the loop thread should co_await its own scheduler next
+    //   * formatAsync(text, callback, stop): callback(result, error) is called exactly once,
+    //     inline for small inputs or on a pool thread for large ones
+    //   * formatFuture(text, stop): a std::future<std::string>
+    // - The job keeps its own reference to the strategy, so setFormatter() may be called while
+    //   jobs are in flight; the processor itself must outlive every job it started
+    static constexpr size_t asyncInlineThreshold = 64 * 1024;
+    static constexpr size_t asyncSliceSize = 256 * 1024;
+
+    using AsyncCallback = std::function<void(std::string result, std::exception_ptr error)>;
+
+    class AsyncFormat {
+    public:
+        bool await_ready() {
+            if (pool)
+                return false;
+            run();
+            return true;
+        }
+
+        void await_suspend(std::coroutine_handle<> caller) {
+            pool->submit([this, caller] {
+                run();
+                caller.resume();
+            });
+        }
+
+        std::string await_resume() {
+            if (error)
+                std::rethrow_exception(error);
+            return std::move(text);
+        }
+
+    private:
+        friend class TextProcessor;
+
+        AsyncFormat(std::shared_ptr<ITextFormatter> f, std::string t, std::stop_token s, ThreadPool* p)
+            : formatter(std::move(f)), text(std::move(t)), stop(std::move(s)), pool(p) {}
+
+        void run() {
+            try {
+                formatCancellable(formatter.get(), text, stop);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        std::shared_ptr<ITextFormatter> formatter;
+        std::string text;
+        std::stop_token stop;
+        ThreadPool* pool; // nullptr: formatted inline in await_ready()
+        std::exception_ptr error;
+    };
+
+    AsyncFormat formatAsync(std::string text, std::stop_token stop = {}) {
+        ThreadPool* workers = formatter && text.size() >= asyncInlineThreshold ? &threadPool() : nullptr;
+        return AsyncFormat(formatter, std::move(text), std::move(stop), workers);
+    }
+
+    void formatAsync(std::string text, AsyncCallback callback, std::stop_token stop = {}) {
+        auto job = [f = formatter, text = std::move(text), callback = std::move(callback),
+                    stop = std::move(stop)]() mutable {
+            std::exception_ptr error;
+            try {
+                formatCancellable(f.get(), text, stop);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            callback(error ? std::string() : std::move(text), error);
+        };
+        if (formatter && text.size() >= asyncInlineThreshold)
+            threadPool().submit(std::move(job));
+        else
+            job();
+    }
+
+    std::future<std::string> formatFuture(std::string text, std::stop_token stop = {}) {
+        auto promise = std::make_shared<std::promise<std::string>>();
+        std::future<std::string> result = promise->get_future();
+        formatAsync(std::move(text), [promise](std::string formatted, std::exception_ptr error) {
+            if (error)
+                promise->set_exception(error);
+            else
+                promise->set_value(std::move(formatted));
+        }, std::move(stop));
+        return result;
+    }
+
+    // File Formatting
+    // Educational Walkthrough Notes:
+    // - formatFile() formats a whole file without ever holding it in a std::string
+    // - On POSIX systems the input is mmap()ed read-only, the output file is ftruncate()d to the
+    //   same length and mmap()ed shared, and the strategy writes straight into the page cache
+    // - madvise(MADV_SEQUENTIAL) tells the kernel to read ahead aggressively and drop pages behind us;
+    //   MADV_HUGEPAGE is requested where the platform offers it, to cut TLB misses on multi-GB files
+    // - Passing the same path for input and output formats the file in place (one shared mapping)
+    // - Large files are split across the thread pool exactly like format(format_policy::par, ...)
+    //   (in topology-aware mode the output file's page-cache pages are first touched by the worker,
+    //   and so on the node, that fills them)
+    // - Failures are reported by throwing std::system_error carrying the errno of the failed call
+    void formatFile(const std::string& inputPath, const std::string& outputPath) {
+#if defined(_WIN32)
+        // Portable fallback: read the file into memory, format it, write it back
+        std::ifstream in(inputPath, std::ios::binary);
+        if (!in)
+            throw std::system_error(errno, std::generic_category(), "formatFile: cannot open '" + inputPath + "'");
+        std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        formatInPlace(format_policy::par, text);
+        std::ofstream out(outputPath, std::ios::binary | std::ios::trunc);
+        if (!out.write(text.data(), static_cast<std::streamsize>(text.size())))
+            throw std::system_error(errno, std::generic_category(), "formatFile: cannot write '" + outputPath + "'");
+#else
+        auto fail = [](const std::string& what, const std::string& path) {
+            throw std::system_error(errno, std::generic_category(), "formatFile: " + what + " '" + path + "'");
+        };
+        // Closes the descriptors and unmaps the regions on every exit path, including exceptions
+        struct Mapping {
+            int fd = -1;
+            void* addr = MAP_FAILED;
+            size_t length = 0;
+            ~Mapping() {
+                if (addr != MAP_FAILED) munmap(addr, length);
+                if (fd >= 0) close(fd);
+            }
+        };
+
+        Mapping in;
+        in.fd = open(inputPath.c_str(), O_RDONLY);
+        if (in.fd < 0) fail("cannot open", inputPath);
+        struct stat inStat;
+        if (fstat(in.fd, &inStat) != 0) fail("cannot stat", inputPath);
+        size_t size = static_cast<size_t>(inStat.st_size);
+
+        // Same file (by device and inode, not just by spelling of the path): format in place
+        struct stat outStat;
+        bool inPlace = stat(outputPath.c_str(), &outStat) == 0
+            && outStat.st_dev == inStat.st_dev && outStat.st_ino == inStat.st_ino;
+
+        Mapping out;
+        out.fd = inPlace ? open(outputPath.c_str(), O_RDWR)
+                         : open(outputPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (out.fd < 0) fail("cannot open", outputPath);
+        if (size == 0)
+            return;
+
+        auto mapInput = [&] {
+            in.length = size;
+            in.addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, in.fd, 0);
+            if (in.addr == MAP_FAILED) fail("cannot map", inputPath);
+            adviseSequential(in.addr, size);
+            return std::string_view(static_cast<const char*>(in.addr), size);
+        };
+        auto mapOutput = [&](size_t length) {
+            if (ftruncate(out.fd, static_cast<off_t>(length)) != 0) fail("cannot resize", outputPath);
+            out.length = length;
+            out.addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, out.fd, 0);
+            if (out.addr == MAP_FAILED) fail("cannot map", outputPath);
+            adviseSequential(out.addr, length);
+            return std::span<char>(static_cast<char*>(out.addr), length);
+        };
+
+        // Length-changing strategies: size the output first, then write it in one pass
+        // (in place, the result has to be staged in memory because it may outgrow the input)
+        if (formatter && !formatter->isLengthPreserving()) {
+            std::string_view source = mapInput();
+            if (inPlace) {
+                std::string result(source);
+                formatter->formatInPlace(result);
+                std::span<char> dest = mapOutput(result.size());
+                memcpy(dest.data(), result.data(), result.size());
+            }
+            else {
+                size_t outSize = formatter->formattedSize(source);
+                if (outSize > 0)
+                    formatter->formatInto(source, mapOutput(outSize));
+            }
+            return;
+        }
+
+        std::span<char> dest = mapOutput(size);
+        std::string_view source = inPlace ? std::string_view(dest.data(), size) : mapInput();
+        if (formatter)
+            formatRange(source, dest, true);
+        else if (!inPlace)
+            memcpy(dest.data(), source.data(), size);
+#endif
+    }
+
+    // Bulk Directory Formatting
+    // Educational Walkthrough Notes:
+    // - formatDirectory() formats every regular file below 'inputDir' into the same relative path
+    //   below 'outputDir' (creating directories as needed) and returns the number of files written;
+    //   passing the same directory twice formats the files in place
+    // - Files are dealt out to the pool's workers through one atomic counter, so a worker that
+    //   draws small files simply takes more of them
+    // - io_uring backend: each worker owns a Ring with 'bulkSlotsPerRing' slots and a registered
+    //   buffer per slot; a slot walks one file through open input -> open output ->
+    //   (read -> format -> write)* -> close input -> close output, one ring operation per step,
+    //   so up to bulkSlotsPerRing files per worker are in flight and every step of every file is
+    //   submitted in batches; the worker that reaps a read completion formats that block right
+    //   away, while it is hot in cache
+    // - Each block is formatted with formatChunk() and the previous block's last byte, exactly as
+    //   in streaming mode, so files larger than one buffer need no special case
+    // - Thread-pool backend (no io_uring, or a strategy that cannot be chunked): each worker
+    //   formats whole files with pread()/pwrite() and a reusable per-worker buffer
+    // - BulkBackend::automatic picks io_uring when the kernel supports it; BulkBackend::ioUring
+    //   throws std::system_error(ENOSYS) instead of falling back
+    // - One failing file does not stop the batch: every file is attempted and the first failure
+    //   is then thrown as std::system_error naming the file
+    static constexpr size_t bulkBufferSize = 128 * 1024;
+    static constexpr unsigned bulkSlotsPerRing = 32;
+
+    size_t formatDirectory(const std::string& inputDir, const std::string& outputDir,
+                           BulkBackend backend = BulkBackend::automatic) {
+        namespace fs = std::filesystem;
+        const fs::path inRoot(inputDir), outRoot(outputDir);
+        fs::create_directories(outRoot);
+        const bool inPlace = fs::equivalent(inRoot, outRoot);
+        std::vector<BulkJob> jobs;
+        for (const fs::directory_entry& entry : fs::recursive_directory_iterator(inRoot)) {
+            if (!entry.is_regular_file())
+                continue;
+            fs::path target = outRoot / fs::relative(entry.path(), inRoot);
+            if (!inPlace)
+                fs::create_directories(target.parent_path());
+            jobs.push_back({entry.path().string(), target.string()});
+        }
+        if (jobs.empty())
+            return 0;
+
+        BulkRun run(jobs, inPlace);
+        bool ring = false;
+#if defined(TEXTFORMATTER_HAS_IO_URING)
+        ring = backend != BulkBackend::threadPool && supportsChunking() && io_ring::Ring::create(1) != nullptr;
+#endif
+        if (backend == BulkBackend::ioUring && !ring)
+            throw std::system_error(ENOSYS, std::generic_category(), "formatDirectory: io_uring unavailable for this strategy");
+
+        size_t workerCount = std::min<size_t>(getThreadCount(), jobs.size());
+        threadPool().runAll(workerCount, [&](size_t) {
+#if defined(TEXTFORMATTER_HAS_IO_URING)
+            if (ring)
+                return formatJobsWithRing(run);
+#endif
+            formatJobsWithPread(run);
+        });
+        if (run.failure)
+            std::rethrow_exception(run.failure);
+        return run.formatted.load();
+    }
+
+private:
+    struct BulkJob {
+        std::string input, output;
+    };
+
+    // State shared by the workers of one formatDirectory() call
+    struct BulkRun {
+        const std::vector<BulkJob>& jobs;
+        bool inPlace;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> formatted{0};
+        std::mutex failureLock;
+        std::exception_ptr failure;
+
+        BulkRun(const std::vector<BulkJob>& jobs, bool inPlace) : jobs(jobs), inPlace(inPlace) {}
+
+        void fail(int error, const char* what, const std::string& path) {
+            std::lock_guard<std::mutex> guard(failureLock);
+            if (!failure)
+                failure = std::make_exception_ptr(std::system_error(
+                    error, std::generic_category(), std::string("formatDirectory: ") + what + " '" + path + "'"));
+        }
+
+        int outputFlags() const { return inPlace ? O_WRONLY | O_CLOEXEC : O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC; }
+    };
+
+#if defined(_WIN32)
+    void formatJobsWithPread(BulkRun& run) {
+        for (size_t j; (j = run.next.fetch_add(1)) < run.jobs.size();) {
+            try {
+                formatFile(run.jobs[j].input, run.jobs[j].output);
+                run.formatted.fetch_add(1);
+            }
+            catch (const std::system_error& e) {
+                run.fail(e.code().value(), "cannot format", run.jobs[j].input);
+            }
+        }
+    }
+#else
+    // Thread-pool backend: one file at a time per worker, through a reusable buffer
+    void formatJobsWithPread(BulkRun& run) {
+        std::vector<char> buffer(bulkBufferSize);
+        std::string whole, result;
+        for (size_t j; (j = run.next.fetch_add(1)) < run.jobs.size();) {
+            const BulkJob& job = run.jobs[j];
+            int in = open(job.input.c_str(), O_RDONLY | O_CLOEXEC);
+            if (in < 0) {
+                run.fail(errno, "cannot open", job.input);
+                continue;
+            }
+            int out = open(job.output.c_str(), run.outputFlags(), 0644);
+            if (out < 0) {
+                run.fail(errno, "cannot open", job.output);
+                close(in);
+                continue;
+            }
+            // Returns false (with errno set) on failure; a zero-byte write is reported as EIO
+            auto writeAll = [out](const char* data, size_t size, off_t offset) {
+                while (size > 0) {
+                    ssize_t n = pwrite(out, data, size, offset);
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n == 0) errno = EIO;
+                    if (n <= 0) return false;
+                    data += n;
+                    size -= static_cast<size_t>(n);
+                    offset += n;
+                }
+                return true;
+            };
+
+            bool ok = true;
+            const char* failedStep = nullptr;
+            const std::string* failedPath = &job.output;
+            off_t offset = 0;
+            char preceding = ' ';
+            whole.clear();
+            for (;;) {
+                ssize_t n = pread(in, buffer.data(), buffer.size(), offset);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) {
+                    ok = false;
+                    failedStep = "cannot read";
+                    failedPath = &job.input;
+                    break;
+                }
+                if (n == 0) break;
+                std::span<char> block(buffer.data(), static_cast<size_t>(n));
+                if (supportsChunking()) {
+                    // Remember the unformatted last byte before the block is rewritten in place
+                    char last = block.back();
+                    formatChunk(block, preceding);
+                    preceding = last;
+                    if (!writeAll(block.data(), block.size(), offset)) {
+                        ok = false;
+                        failedStep = "cannot write";
+                        break;
+                    }
+                }
+                else {
+                    whole.append(block.data(), block.size());
+                }
+                offset += n;
+            }
+            // Strategies that cannot be chunked see the whole file; the result may change length
+            if (ok && !supportsChunking()) {
+                formatInto(whole, result);
+                if (!writeAll(result.data(), result.size(), 0) || (run.inPlace && ftruncate(out, static_cast<off_t>(result.size())) != 0)) {
+                    ok = false;
+                    failedStep = "cannot write";
+                }
+            }
+            if (!ok)
+                run.fail(errno, failedStep, *failedPath);
+            close(in);
+            if (close(out) != 0 && ok) {
+                run.fail(errno, "cannot close", job.output);
+                ok = false;
+            }
+            if (ok)
+                run.formatted.fetch_add(1);
+        }
+    }
+#endif
+
+#if defined(TEXTFORMATTER_HAS_IO_URING)
+    // io_uring backend: a per-worker ring keeps up to bulkSlotsPerRing files in flight
+    void formatJobsWithRing(BulkRun& run) {
+        std::unique_ptr<io_ring::Ring> ring = io_ring::Ring::create(bulkSlotsPerRing);
+        if (!ring)
+            return formatJobsWithPread(run);
+
+        enum class Step { openInput, openOutput, read, write, closeInput, closeOutput };
+        struct Slot {
+            size_t job = 0;
+            int in = -1, out = -1;
+            uint64_t offset = 0;
+            size_t length = 0, written = 0;
+            char preceding = ' ';
+            Step step = Step::openInput;
+            char* buffer = nullptr;
+        };
+        std::unique_ptr<char[]> storage(new char[bulkSlotsPerRing * bulkBufferSize]);
+        std::vector<Slot> slots(bulkSlotsPerRing);
+        std::vector<iovec> buffers(bulkSlotsPerRing);
+        for (unsigned i = 0; i < bulkSlotsPerRing; ++i) {
+            slots[i].buffer = storage.get() + size_t(i) * bulkBufferSize;
+            buffers[i] = {slots[i].buffer, bulkBufferSize};
+        }
+        const bool fixed = ring->registerBuffers(buffers.data(), bulkSlotsPerRing);
+        unsigned active = 0;
+
+        auto openFile = [&](unsigned i, const std::string& path, int flags) {
+            io_uring_sqe& sqe = ring->prepare(IORING_OP_OPENAT, AT_FDCWD, i);
+            sqe.addr = reinterpret_cast<uintptr_t>(path.c_str());
+            sqe.len = 0644;
+            sqe.open_flags = static_cast<unsigned>(flags);
+        };
+        auto transfer = [&](unsigned i, bool reading) {
+            Slot& s = slots[i];
+            unsigned char op = reading ? (fixed ? IORING_OP_READ_FIXED : IORING_OP_READ)
+                                       : (fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE);
+            io_uring_sqe& sqe = ring->prepare(op, reading ? s.in : s.out, i);
+            sqe.addr = reinterpret_cast<uintptr_t>(s.buffer + (reading ? 0 : s.written));
+            sqe.len = static_cast<unsigned>(reading ? bulkBufferSize : s.length - s.written);
+            sqe.off = s.offset + (reading ? 0 : s.written);
+            sqe.buf_index = static_cast<uint16_t>(i);
+            s.step = reading ? Step::read : Step::write;
+        };
+        auto closeFile = [&](unsigned i, int& fd, Step step) {
+            ring->prepare(IORING_OP_CLOSE, fd, i);
+            fd = -1;
+            slots[i].step = step;
+        };
+        // Releases whatever the slot still holds and starts its next file, if any is left
+        auto nextFile = [&](unsigned i) {
+            Slot& s = slots[i];
+            if (s.in >= 0) close(s.in);
+            if (s.out >= 0) close(s.out);
+            char* buffer = s.buffer;
+            s = Slot{};
+            s.buffer = buffer;
+            s.job = run.next.fetch_add(1);
+            if (s.job >= run.jobs.size()) {
+                --active;
+                return;
+            }
+            openFile(i, run.jobs[s.job].input, O_RDONLY | O_CLOEXEC);
+        };
+        auto complete = [&](uint64_t userData, int result) {
+            unsigned i = static_cast<unsigned>(userData);
+            Slot& s = slots[i];
+            const BulkJob& job = run.jobs[s.job];
+            if (result < 0 || (s.step == Step::write && result == 0)) {
+                bool reading = s.step == Step::openInput || s.step == Step::read || s.step == Step::closeInput;
+                const char* what = s.step == Step::read ? "cannot read" : s.step == Step::write ? "cannot write"
+                                 : s.step == Step::closeInput || s.step == Step::closeOutput ? "cannot close" : "cannot open";
+                run.fail(result < 0 ? -result : EIO, what, reading ? job.input : job.output);
+                return nextFile(i);
+            }
+            switch (s.step) {
+            case Step::openInput:
+                s.in = result;
+                openFile(i, job.output, run.outputFlags());
+                s.step = Step::openOutput;
+                break;
+            case Step::openOutput:
+                s.out = result;
+                transfer(i, true);
+                break;
+            case Step::read:
+                if (result == 0) {
+                    closeFile(i, s.in, Step::closeInput);
+                    break;
+                }
+                s.length = static_cast<size_t>(result);
+                s.written = 0;
+                {
+                    // Remember the unformatted last byte before the block is rewritten in place
+                    char last = s.buffer[s.length - 1];
+                    formatChunk(std::span<char>(s.buffer, s.length), s.preceding);
+                    s.preceding = last;
+                }
+                transfer(i, false);
+                break;
+            case Step::write:
+                s.written += static_cast<size_t>(result);
+                if (s.written < s.length)
+                    transfer(i, false);
+                else {
+                    s.offset += s.length;
+                    transfer(i, true);
+                }
+                break;
+            case Step::closeInput:
+                closeFile(i, s.out, Step::closeOutput);
+                break;
+            case Step::closeOutput:
+                run.formatted.fetch_add(1);
+                nextFile(i);
+                break;
+            }
+        };
+
+        try {
+            for (unsigned i = 0; i < bulkSlotsPerRing; ++i) {
+                ++active;
+                nextFile(i);
+            }
+            while (active > 0) {
+                ring->submitAndWait();
+                ring->drain(complete);
+            }
+        }
+        catch (...) {
+            for (Slot& s : slots) {
+                if (s.in >= 0) close(s.in);
+                if (s.out >= 0) close(s.out);
+            }
+            throw;
+        }
+    }
+#endif
+
+#if !defined(_WIN32)
+    static void adviseSequential(void* addr, size_t length) {
+        madvise(addr, length, MADV_SEQUENTIAL);
+#if defined(MADV_HUGEPAGE)
+        madvise(addr, length, MADV_HUGEPAGE);
+#endif
+    }
+#endif
+};
+
+// Hazard Pointers: lock-free safe reclamation for the concurrent context below
+// Educational Walkthrough Notes:
+// - A reader that loads a raw strategy pointer must be sure no writer deletes the object while it
+//   is still being used; a hazard pointer is a per-reader slot that says "I am using this object"
+// - Reader protocol: load the published pointer, store it into a hazard slot, then load it again;
+//   if both loads agree the object is protected, because any writer that swapped it out after
+//   that point will see the slot when it scans (all three operations are sequentially consistent)
+// - Writers never free a replaced object directly: they retire it, and an object is only deleted
+//   once no hazard slot holds it; anything still in use is simply kept for the next scan
+// - The records form a grow-only, lock-free list shared by every ConcurrentTextProcessor; a
+//   record is claimed per call with one exchange (normally on the record this thread used last),
+//   so nested calls and any number of threads work without a fixed slot limit
+// - std::atomic<std::shared_ptr> would be the textbook alternative, but libstdc++ implements it
+//   with an internal lock, which would put a lock back on every reader's path
+class HazardPointerDomain {
+public:
+    struct Record {
+        std::atomic<const void*> hazard{nullptr};
+        std::atomic<bool> active{false};
+        Record* next = nullptr;
+    };
+
+    static HazardPointerDomain& instance() {
+        static HazardPointerDomain domain;
+        return domain;
+    }
+
+    // Claims a free record (lock-free: an exchange on a cached hint, else a scan, else a push)
+    Record* acquire() {
+        thread_local Record* hint = nullptr;
+        if (hint && !hint->active.exchange(true, std::memory_order_acquire))
+            return hint;
+        for (Record* r = head.load(std::memory_order_acquire); r; r = r->next) {
+            if (!r->active.load(std::memory_order_relaxed) && !r->active.exchange(true, std::memory_order_acquire))
+                return hint = r;
+        }
+        Record* r = new Record;
+        r->active.store(true, std::memory_order_relaxed);
+        r->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed)) {}
+        return hint = r;
+    }
+
+    void release(Record* r) {
+        r->hazard.store(nullptr, std::memory_order_release);
+        r->active.store(false, std::memory_order_release);
+    }
+
+    // True while any reader has 'p' in its hazard slot
+    bool isProtected(const void* p) const {
+        for (Record* r = head.load(std::memory_order_acquire); r; r = r->next)
+            if (r->hazard.load() == p)
+                return true;
+        return false;
+    }
+
+private:
+    std::atomic<Record*> head{nullptr};
+
+    HazardPointerDomain() = default;
+    // Records stay reachable for the life of the program (the list only ever grows, bounded by the
+    // peak number of concurrent calls); they are released here at exit
+    ~HazardPointerDomain() {
+        for (Record* r = head.load(); r;) {
+            Record* next = r->next;
+            delete r;
+            r = next;
+        }
+    }
+};
+
+// Concurrent Context: a TextProcessor whose strategy can be swapped while other threads format
+// Educational Walkthrough Notes:
+// - TextProcessor::setFormatter() replaces a unique_ptr with no synchronization, so a processor
+//   shared between threads has to be rebuilt and redistributed to change its policy
+// - Here the active strategy is an atomic pointer: setFormatter() publishes the new strategy with
+//   one atomic exchange, and every call that starts afterwards sees it
+// - Readers never take a lock: each call protects the strategy it loaded with a hazard pointer
+//   (see HazardPointerDomain), and calls already in flight finish on the strategy they started with
+// - Replaced strategies are deleted once no reader still holds them; writers serialize among
+//   themselves on a mutex that readers never touch
+// - Strategies are shared by all threads at once, so they must be safe to call concurrently; the
+//   built-in strategies are, because they keep no state between calls
+class ConcurrentTextProcessor {
+private:
+    std::atomic<ITextFormatter*> current{nullptr};
+
+    // Replaced strategies that a reader may still be using (guarded by writeLock)
+    std::mutex writeLock;
+    std::vector<std::unique_ptr<ITextFormatter>> retired;
+
+    // RAII reader: protects the current strategy for the lifetime of the guard
+    class Guard {
+    public:
+        explicit Guard(const std::atomic<ITextFormatter*>& source)
+            : record(HazardPointerDomain::instance().acquire()) {
+            ITextFormatter* f = source.load();
+            do {
+                formatter = f;
+                record->hazard.store(f);
+                f = source.load();
+            } while (f != formatter);
+        }
+
+        ~Guard() { HazardPointerDomain::instance().release(record); }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ITextFormatter* get() const { return formatter; }
+
+    private:
+        HazardPointerDomain::Record* record;
+        ITextFormatter* formatter = nullptr;
+    };
+
+    // Deletes every retired strategy that no reader has protected; the rest wait for the next swap
+    void reclaim() {
+        auto& domain = HazardPointerDomain::instance();
+        std::erase_if(retired, [&](const std::unique_ptr<ITextFormatter>& f) {
+            return !domain.isProtected(f.get());
+        });
+    }
+
+public:
+    ConcurrentTextProcessor() = default;
+    ConcurrentTextProcessor(const ConcurrentTextProcessor&) = delete;
+    ConcurrentTextProcessor& operator=(const ConcurrentTextProcessor&) = delete;
+
+    // No call may still be running when the processor itself is destroyed
+    ~ConcurrentTextProcessor() { delete current.load(); }
+
+    // Publishes a new strategy; safe to call while other threads are formatting
+    // The strategy is bound to the active locale's tables before it becomes visible
+    void setFormatter(std::unique_ptr<ITextFormatter> f) {
+        if (f)
+            f->useCaseTables(CaseTables::forCurrentLocale());
+        std::lock_guard<std::mutex> guard(writeLock);
+        ITextFormatter* old = current.exchange(f.release());
+        if (old)
+            retired.emplace_back(old);
+        reclaim();
+    }
+
+    // Number of replaced strategies still waiting for their readers to finish
+    size_t pendingReclaim() {
+        std::lock_guard<std::mutex> guard(writeLock);
+        reclaim();
+        return retired.size();
+    }
+
+    // Same entry points and pass-through behavior as TextProcessor
+    std::string format(const std::string& text) {
+        Guard guard(current);
+        return guard.get() ? guard.get()->format(text) : text;
+    }
+
+    std::string format(std::string&& text) {
+        formatInPlace(text);
+        return std::move(text);
+    }
+
+    void formatInPlace(std::string& text) {
+        Guard guard(current);
+        if (guard.get())
+            guard.get()->formatInPlace(text);
+    }
+
+    void formatInto(std::string_view text, std::string& out) {
+        Guard guard(current);
+        if (guard.get())
+            guard.get()->formatInto(text, out);
+        else
+            out.assign(text);
+    }
+
+    size_t formatInto(std::string_view text, std::span<char> out) {
+        Guard guard(current);
+        if (guard.get())
+            return guard.get()->formatInto(text, out);
+        if (out.size() < text.size())
+            throw std::length_error("ConcurrentTextProcessor::formatInto: output buffer too small");
+        return text.copy(out.data(), text.size());
+    }
+
+    void formatBatch(std::span<const std::string_view> inputs, FormattedBatch& out) {
+        Guard guard(current);
+        if (guard.get())
+            guard.get()->formatBatch(inputs, out);
+        else
+            out.pack(inputs);
+    }
+};
+
+// Compile-Time Strategy Selection
+// Educational Walkthrough Notes:
+// - TextProcessor picks its strategy at runtime, so every call goes through a heap-allocated
+//   object and a virtual function; that flexibility is the whole point of the Strategy pattern
+// - Most call sites, however, know the strategy when they are compiled; for them the two classes
+//   below keep the same interface but resolve the strategy statically:
+//   * StaticTextProcessor<F> stores F by value and calls F's kernel with a qualified name, so the
+//     compiler sees the loop body at the call site and can inline and vectorize across it
+//   * VariantTextProcessor stores one of the built-in strategies inside a std::variant; dispatch
+//     becomes a switch on the variant's index (a jump table) and no heap object is involved
+// - bench/TextFormatterBench.cpp measures all three dispatch styles against each other
+
+// Any type with a formatSpan(std::span<char>) kernel can be used as a compile-time strategy
+template <typename F>
+concept SpanFormatter = requires(F& f, std::span<char> text) { f.formatSpan(text); };
+
+template <SpanFormatter F>
+class StaticTextProcessor {
+private:
+    // The strategy lives inside the context (no pointer, no heap allocation)
+    F formatter;
+
+    // Qualified call: names F's own formatSpan, so virtual dispatch is bypassed even when F
+    // derives from ITextFormatter
+    void apply(std::span<char> text) { formatter.F::formatSpan(text); }
+
+    // Like TextProcessor::setFormatter(), binds a table-driven strategy to the active locale's
+    // tables once, so the three contexts format alike; other SpanFormatters are left alone
+    void bindTables() {
+        if constexpr (requires { formatter.useCaseTables(CaseTables::forCurrentLocale()); })
+            formatter.useCaseTables(CaseTables::forCurrentLocale());
+    }
+
+public:
+    StaticTextProcessor() { bindTables(); }
+    explicit StaticTextProcessor(F f) : formatter(std::move(f)) { bindTables(); }
+
+    std::string format(const std::string& text) {
+        std::string result = text;
+        apply(result);
+        return result;
+    }
+
+    std::string format(std::string&& text) {
+        apply(text);
+        return std::move(text);
+    }
+
+    void formatInPlace(std::string& text) { apply(text); }
+
+    void formatInto(std::string_view text, std::string& out) {
+        out.assign(text);
+        apply(out);
+    }
+
+    size_t formatInto(std::string_view text, std::span<char> out) {
+        if (out.size() < text.size())
+            throw std::length_error("StaticTextProcessor::formatInto: output buffer too small");
+        std::span<char> dest = out.first(text.size());
+        text.copy(dest.data(), dest.size());
+        apply(dest);
+        return dest.size();
+    }
+
+    void formatBatch(std::span<const std::string_view> inputs, FormattedBatch& out) {
+        out.pack(inputs);
+        if constexpr (std::derived_from<F, ITextFormatter>)
+            formatter.F::formatSegments(out, 0, out.size());
+        else
+            for (size_t i = 0; i < out.size(); ++i) apply(out.segment(i));
+    }
+};
+
+// The closed set of strategies a VariantTextProcessor can hold
+// std::monostate plays the role of TextProcessor's nullptr: no strategy, text passes through
+using BuiltinFormatter = std::variant<std::monostate, UpperCaseFormatter, LowerCaseFormatter, TitleCaseFormatter>;
+
+class VariantTextProcessor {
+private:
+    BuiltinFormatter formatter;
+
+    void apply(std::span<char> text) {
+        std::visit([text](auto& f) {
+            using F = std::remove_reference_t<decltype(f)>;
+            if constexpr (!std::is_same_v<F, std::monostate>)
+                f.F::formatSpan(text);
+        }, formatter);
+    }
+
+    // Like TextProcessor, a strategy is bound to the active locale's tables when it is handed
+    // over, once: by the constructor as well as by setFormatter()
+    void bindTables() {
+        std::visit([](auto& s) {
+            if constexpr (!std::is_same_v<std::remove_reference_t<decltype(s)>, std::monostate>)
+                s.useCaseTables(CaseTables::forCurrentLocale());
+        }, formatter);
+    }
+
+public:
+    VariantTextProcessor() = default;
+    explicit VariantTextProcessor(BuiltinFormatter f) : formatter(std::move(f)) { bindTables(); }
+
+    // Switching strategy is a plain assignment: the old alternative is destroyed in place
+    void setFormatter(BuiltinFormatter f) {
+        formatter = std::move(f);
+        bindTables();
+    }
+
+    std::string format(const std::string& text) {
+        std::string result = text;
+        apply(result);
+        return result;
+    }
+
+    std::string format(std::string&& text) {
+        apply(text);
+        return std::move(text);
+    }
+
+    void formatInPlace(std::string& text) { apply(text); }
+
+    void formatInto(std::string_view text, std::string& out) {
+        out.assign(text);
+        apply(out);
+    }
+
+    size_t formatInto(std::string_view text, std::span<char> out) {
+        if (out.size() < text.size())
+            throw std::length_error("VariantTextProcessor::formatInto: output buffer too small");
+        std::span<char> dest = out.first(text.size());
+        text.copy(dest.data(), dest.size());
+        apply(dest);
+        return dest.size();
+    }
+
+    void formatBatch(std::span<const std::string_view> inputs, FormattedBatch& out) {
+        out.pack(inputs);
+        std::visit([&out](auto& f) {
+            using F = std::remove_reference_t<decltype(f)>;
+            if constexpr (!std::is_same_v<F, std::monostate>)
+                f.F::formatSegments(out, 0, out.size());
+        }, formatter);
+    }
+};
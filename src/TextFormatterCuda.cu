@@ -0,0 +1,181 @@
+/*
+File:           TextFormatterCuda.cu
+Description:    CUDA backend for the bytewise case strategies (see TextFormatterGpu.h).
+                - One kernel per operation over 16-byte vectors, with "C" locale semantics that match
+                  ascii_kernels::convertScalar() / titleScalar() in TextFormatter.h byte for byte
+                - The input is streamed through the device in fixed-size chunks on several CUDA
+                  streams, so uploads, kernels and downloads of neighbouring chunks overlap
+
+Build & run:
+                nvcc -std=c++17 -O3 -c src/TextFormatterCuda.cu -o textformatter_cuda.o
+                (then link it into a -DTEXTFORMATTER_WITH_CUDA build with -lcudart)
+
+Educational Walkthrough Notes:
+                - Staging: the GPU can only DMA from page-locked ("pinned") host memory; an ordinary
+                  caller buffer would be copied through a hidden driver buffer synchronously, so each
+                  stream owns pinned input and output buffers (cudaHostAlloc) that are filled and
+                  drained with memcpy while the other streams keep the copy engines and SMs busy
+                - Pipeline: with slotCount streams, chunk k uses slot k % slotCount; before reusing a
+                  slot the host waits for its previous chunk and copies that result out, then stages
+                  the next chunk - so at any time one chunk is being uploaded, one computed and one
+                  downloaded, and the host copies overlap all three
+                - Title case: each output byte depends only on whether the byte before it is
+                  whitespace, so no scan is needed; a thread reads the byte before its 16-byte vector
+                  (the chunk's 'preceding' byte for the very first thread); chunk boundaries inside
+                  one call pass the last input byte of the previous chunk the same way
+                - Everything is set up lazily, once, under a mutex, and kept for the process: pinned
+                  allocations and stream creation cost milliseconds, far more than one chunk
+                - Any CUDA error makes transform() return false; the CPU path then formats the whole
+                  range again, which is correct even in place, because all three operations are
+                  idempotent (upper(upper(x)) == upper(x), and title case only looks at whitespace)
+*/
+
+#include "TextFormatterGpu.h"
+
+#include <cuda_runtime.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+constexpr size_t chunkSize = size_t(32) << 20; // per slot; a multiple of 16
+constexpr int slotCount = 3;
+constexpr int threadsPerBlock = 256;
+
+__device__ __forceinline__ bool isSpace(unsigned char c) {
+    return c == ' ' || static_cast<unsigned char>(c - '\t') < 5;
+}
+
+// One byte of the operation; 'capitalize' (title only) says whether the byte before was whitespace
+__device__ __forceinline__ unsigned char apply(gpu::CaseOp op, unsigned char c, bool capitalize) {
+    char first = op == gpu::CaseOp::upper ? 'a'
+               : op == gpu::CaseOp::lower ? 'A'
+               : capitalize ? 'a' : 'A';
+    if (op == gpu::CaseOp::title && isSpace(c))
+        return c;
+    return static_cast<unsigned char>(c - first) < 26 ? c ^ 0x20 : c;
+}
+
+// Each thread formats 16 bytes (one uint4 load and store when the vector is complete)
+__global__ void caseKernel(gpu::CaseOp op, const unsigned char* __restrict__ in, unsigned char* __restrict__ out,
+                           size_t size, unsigned char preceding) {
+    size_t begin = (static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x) * 16;
+    if (begin >= size)
+        return;
+    bool capitalize = isSpace(begin == 0 ? preceding : in[begin - 1]);
+    if (begin + 16 <= size) {
+        uint4 vector = *reinterpret_cast<const uint4*>(in + begin);
+        unsigned char* bytes = reinterpret_cast<unsigned char*>(&vector);
+#pragma unroll
+        for (int i = 0; i < 16; ++i) {
+            unsigned char c = bytes[i];
+            bytes[i] = apply(op, c, capitalize);
+            capitalize = isSpace(c);
+        }
+        *reinterpret_cast<uint4*>(out + begin) = vector;
+        return;
+    }
+    for (size_t i = begin; i < size; ++i) {
+        unsigned char c = in[i];
+        out[i] = apply(op, c, capitalize);
+        capitalize = isSpace(c);
+    }
+}
+
+struct Slot {
+    cudaStream_t stream = nullptr;
+    char* hostIn = nullptr;
+    char* hostOut = nullptr;
+    unsigned char* deviceIn = nullptr;
+    unsigned char* deviceOut = nullptr;
+    char* pendingDest = nullptr; // where the chunk in flight goes, nullptr when the slot is idle
+    size_t pendingSize = 0;
+};
+
+struct Device {
+    std::mutex lock;
+    bool ready = false;
+    bool failed = false;
+    Slot slots[slotCount];
+
+    bool setUp() {
+        if (ready || failed)
+            return ready;
+        int count = 0;
+        failed = cudaGetDeviceCount(&count) != cudaSuccess || count == 0;
+        for (Slot& slot : slots) {
+            if (failed)
+                break;
+            failed = cudaStreamCreateWithFlags(&slot.stream, cudaStreamNonBlocking) != cudaSuccess
+                || cudaHostAlloc(reinterpret_cast<void**>(&slot.hostIn), chunkSize, cudaHostAllocWriteCombined) != cudaSuccess
+                || cudaHostAlloc(reinterpret_cast<void**>(&slot.hostOut), chunkSize, cudaHostAllocDefault) != cudaSuccess
+                || cudaMalloc(reinterpret_cast<void**>(&slot.deviceIn), chunkSize) != cudaSuccess
+                || cudaMalloc(reinterpret_cast<void**>(&slot.deviceOut), chunkSize) != cudaSuccess;
+        }
+        ready = !failed;
+        return ready;
+    }
+
+    // Waits for the slot's chunk in flight, if any, and copies its result to the caller's buffer
+    bool finish(Slot& slot) {
+        if (!slot.pendingDest)
+            return true;
+        bool ok = cudaStreamSynchronize(slot.stream) == cudaSuccess;
+        if (ok)
+            memcpy(slot.pendingDest, slot.hostOut, slot.pendingSize);
+        slot.pendingDest = nullptr;
+        return ok;
+    }
+};
+
+Device& device() {
+    static Device instance;
+    return instance;
+}
+
+} // namespace
+
+namespace gpu {
+
+bool available() noexcept {
+    Device& d = device();
+    std::lock_guard<std::mutex> guard(d.lock);
+    return d.setUp();
+}
+
+bool transform(CaseOp op, const char* source, char* dest, size_t size, char preceding) noexcept {
+    Device& d = device();
+    std::lock_guard<std::mutex> guard(d.lock);
+    if (!d.setUp())
+        return false;
+
+    bool ok = true;
+    for (size_t offset = 0, k = 0; ok && offset < size; offset += chunkSize, ++k) {
+        Slot& slot = d.slots[k % slotCount];
+        ok = d.finish(slot);
+        if (!ok)
+            break;
+        size_t length = std::min(chunkSize, size - offset);
+        // Read before any result is copied out: in place, dest[offset - 1] is rewritten only when
+        // the previous chunk's slot is finished, which happens after this chunk is staged
+        unsigned char before = static_cast<unsigned char>(offset == 0 ? preceding : source[offset - 1]);
+        memcpy(slot.hostIn, source + offset, length);
+        unsigned blocks = static_cast<unsigned>((length + 16 * threadsPerBlock - 1) / (16 * threadsPerBlock));
+        ok = cudaMemcpyAsync(slot.deviceIn, slot.hostIn, length, cudaMemcpyHostToDevice, slot.stream) == cudaSuccess;
+        if (ok) {
+            caseKernel<<<blocks, threadsPerBlock, 0, slot.stream>>>(op, slot.deviceIn, slot.deviceOut, length, before);
+            ok = cudaGetLastError() == cudaSuccess
+                && cudaMemcpyAsync(slot.hostOut, slot.deviceOut, length, cudaMemcpyDeviceToHost, slot.stream) == cudaSuccess;
+        }
+        slot.pendingDest = dest + offset;
+        slot.pendingSize = length;
+    }
+    // Drain every slot (also after a failure, so no copy is left running into our buffers)
+    for (Slot& slot : d.slots)
+        ok = d.finish(slot) && ok;
+    return ok;
+}
+
+} // namespace gpu
@@ -0,0 +1,51 @@
+/*
+File:           TextFormatterGpu.h
+Description:    Interface of the optional GPU backend for the bytewise case strategies (upper, lower,
+                title with the "C" tables), shared by TextFormatter.h and TextFormatterCuda.cu.
+                - Without -DTEXTFORMATTER_WITH_CUDA every function is an inline stub reporting "no
+                  GPU", so the header-only build never needs the CUDA toolkit
+                - With it, the definitions come from src/TextFormatterCuda.cu (compiled by nvcc and
+                  linked together with -lcudart)
+
+Build & run:
+                nvcc -std=c++17 -O3 -c src/TextFormatterCuda.cu -o textformatter_cuda.o
+                g++ -std=c++20 -O2 -pthread -DTEXTFORMATTER_WITH_CUDA src/Pattern-Strategy-TextFormatter.cpp \
+                    textformatter_cuda.o -o textformatter -ldl -lcudart
+
+Educational Walkthrough Notes:
+                - The interface is plain pointers and sizes on purpose: the .cu file does not include
+                  TextFormatter.h, so nvcc never has to compile the C++20 CPU code (or its SIMD
+                  intrinsics), and the CPU code never sees a CUDA type
+                - transform() returns false instead of throwing when the device cannot run the job
+                  (no device, out of memory, a failed launch); the caller then formats on the CPU
+*/
+
+#pragma once
+
+#include <cstddef>
+
+namespace gpu {
+
+// The operations the device kernels implement (the ASCII kernels' semantics, byte for byte)
+enum class CaseOp : int { upper = 0, lower = 1, title = 2 };
+
+// Below this size the PCIe round trip (and, on the first call, context creation) costs more than
+// the CPU kernels take; TextProcessor::setGpuOffload() uses it unless told otherwise
+inline constexpr size_t defaultOffloadThreshold = size_t(256) << 20;
+
+// nvcc (__CUDACC__) always sees the declarations, since TextFormatterCuda.cu defines them
+#if defined(TEXTFORMATTER_WITH_CUDA) || defined(__CUDACC__)
+// True when a CUDA device is present and usable (checked once)
+bool available() noexcept;
+
+// Formats source[0, size) into dest (which may be the same buffer, but must not partially overlap
+// it); 'preceding' is the byte before 'source' (a space at the start of a text), as for formatChunk()
+// Returns false, with dest possibly half written, when the device could not do the job
+bool transform(CaseOp op, const char* source, char* dest, size_t size, char preceding) noexcept;
+#else
+inline bool available() noexcept { return false; }
+
+inline bool transform(CaseOp, const char*, char*, size_t, char) noexcept { return false; }
+#endif
+
+} // namespace gpu
@@ -1,7 +1,13 @@
 #!/bin/bash
 
 # Compile the program (optional if already compiled)
-g++ src/Pattern-Strategy-TextFormatter.cpp -o textformatter
+g++ -std=c++20 -O2 -pthread src/Pattern-Strategy-TextFormatter.cpp -o textformatter -ldl
+# Reference build with every SIMD fast path disabled, used by the differential tests below
+g++ -std=c++20 -O2 -pthread -DTEXTFORMATTER_FORCE_SCALAR src/Pattern-Strategy-TextFormatter.cpp -o textformatter_scalar -ldl
+# Example strategy plugin, loaded at runtime with --plugin
+g++ -std=c++20 -O2 -fPIC -shared -Isrc plugins/SwapCasePlugin.cpp -o swapcase.so
+# Differential fuzz driver (standalone build; ./fuzz.sh runs the same target under libFuzzer)
+g++ -std=c++20 -O2 -pthread -Isrc fuzz/DifferentialFuzz.cpp -o textformatter_fuzz
 
 # Define test cases
 declare -a sentences=("tHiS iS a TeSt" "" "hELLO, u$3r@bC!")
@@ -14,10 +20,10 @@ for input_sentence in "${sentences[@]}"; do
     echo "--------------------------------"
 
     # Case 1: Uppercase
-    output=$(printf "%s\n1\n" "$input_sentence" | ./textformatter)
+    output=$(printf "%s" "$input_sentence" | ./textformatter --mode=upper)
     expected=$(echo "$input_sentence" | tr '[:lower:]' '[:upper:]')
     echo "Uppercase Output: '$output'"
-    if echo "$output" | grep -q "$expected"; then
+    if [ "$output" == "$expected" ]; then
         echo "PASS"
     else
         echo "FAIL (expected '$expected')"
@@ -25,10 +31,10 @@ for input_sentence in "${sentences[@]}"; do
     echo
 
     # Case 2: Lowercase
-    output=$(printf "%s\n2\n" "$input_sentence" | ./textformatter)
+    output=$(printf "%s" "$input_sentence" | ./textformatter --mode=lower)
     expected=$(echo "$input_sentence" | tr '[:upper:]' '[:lower:]')
     echo "Lowercase Output: '$output'"
-    if echo "$output" | grep -q "$expected"; then
+    if [ "$output" == "$expected" ]; then
         echo "PASS"
     else
         echo "FAIL (expected '$expected')"
@@ -36,11 +42,11 @@ for input_sentence in "${sentences[@]}"; do
     echo
 
     # Case 3: Title Case
-    output=$(printf "%s\n3\n" "$input_sentence" | ./textformatter)
+    output=$(printf "%s" "$input_sentence" | ./textformatter --mode=title)
     # Expected: capitalize each word (basic approximation)
     expected=$(echo "$input_sentence" | awk '{for(i=1;i<=NF;i++){ $i=toupper(substr($i,1,1)) tolower(substr($i,2)) }}1')
     echo "Title Case Output: '$output'"
-    if echo "$output" | grep -q "$expected"; then
+    if [ "$output" == "$expected" ]; then
         echo "PASS"
     else
         echo "FAIL (expected '$expected')"
@@ -48,13 +54,293 @@ for input_sentence in "${sentences[@]}"; do
     echo
 
     # Default (no formatting)
-    output=$(printf "%s\n\n" "$input_sentence" | ./textformatter)
+    output=$(printf "%s" "$input_sentence" | ./textformatter --mode=none)
     expected="$input_sentence"
     echo "Default Output: '$output'"
-    if echo "$output" | grep -q "$expected"; then
+    if [ "$output" == "$expected" ]; then
         echo "PASS"
     else
         echo "FAIL (expected '$expected')"
     fi
     echo "================================"
 done
+
+# The original menu demo is still there behind --interactive (sentence, then the menu choice)
+output=$(printf 'tHiS iS a TeSt\n3\n' | ./textformatter --interactive | tail -n 1)
+if [ "$output" == "This Is A Test" ]; then
+    echo "PASS (interactive demo)"
+else
+    echo "FAIL (interactive demo: '$output')"
+fi
+output=$(printf 'tHiS iS a TeSt\n\n' | ./textformatter --interactive | tail -n 1)
+if [ "$output" == "tHiS iS a TeSt" ]; then
+    echo "PASS (interactive demo, no choice)"
+else
+    echo "FAIL (interactive demo, no choice: '$output')"
+fi
+# Without arguments and with stdin redirected there is nobody to answer a prompt: usage, status 2
+printf 'tHiS iS a TeSt\n1\n' | ./textformatter > /dev/null 2>&1
+if [ $? -eq 2 ] && ./textformatter --help | grep -q -- "--threads"; then
+    echo "PASS (no prompt without a terminal, --help)"
+else
+    echo "FAIL (no prompt without a terminal, --help)"
+fi
+echo "================================"
+
+# Differential tests: vectorized build vs scalar reference build
+# Inputs mix letters, all six whitespace bytes (except the newline that ends the line),
+# high-bit bytes and punctuation, at lengths that straddle the 16/32/64-byte block sizes
+echo "Running differential tests (SIMD vs scalar)..."
+echo "================================"
+
+diff_failures=0
+for length in 1 15 16 17 31 32 33 63 64 65 127 128 129 1000 4099; do
+    input_file=$(mktemp)
+    head -c $((length * 4)) /dev/urandom | LC_ALL=C tr -dc 'a-zA-Z0-9 \t\013\014\r\200-\377$@!,' | head -c "$length" > "$input_file"
+    for mode in upper lower title; do
+        fast=$(./textformatter --mode=$mode < "$input_file" | od -An -tx1)
+        reference=$(./textformatter_scalar --mode=$mode < "$input_file" | od -An -tx1)
+        if [ "$fast" != "$reference" ]; then
+            echo "FAIL (length $length, mode $mode)"
+            diff_failures=$((diff_failures + 1))
+        fi
+    done
+    rm -f "$input_file"
+done
+
+if [ "$diff_failures" -eq 0 ]; then
+    echo "PASS (SIMD output byte-identical to scalar reference)"
+fi
+echo "================================"
+
+# Differential fuzzing: every kernel and entry point against the in-file reference, on
+# generated inputs (chunk-boundary whitespace, high-bit bytes, broken UTF-8, empty strings)
+fuzz_seed=$RANDOM
+if ./textformatter_fuzz --iterations=2000 --seed=$fuzz_seed > /dev/null; then
+    echo "PASS (differential fuzz, 2000 generated inputs)"
+else
+    echo "FAIL (differential fuzz, reproduce with ./textformatter_fuzz --iterations=2000 --seed=$fuzz_seed)"
+fi
+echo "================================"
+
+# Streaming mode tests: textformatter --mode=<name> < in > out
+echo "Running streaming mode tests..."
+echo "================================"
+
+output=$(printf 'tHiS iS\na TeSt\n' | ./textformatter --mode=title)
+if [ "$output" == $'This Is\nA Test' ]; then
+    echo "PASS (multi-line title case)"
+else
+    echo "FAIL (multi-line title case: '$output')"
+fi
+
+output=$(printf 'hELLO, u$3r@bC!' | ./textformatter --mode=upper)
+if [ "$output" == 'HELLO, U$3R@BC!' ]; then
+    echo "PASS (upper case without trailing newline)"
+else
+    echo "FAIL (upper case without trailing newline: '$output')"
+fi
+
+output=$(printf 'tHiS iS a TeSt' | ./textformatter --mode=upper,lower,title)
+if [ "$output" == 'This Is A Test' ]; then
+    echo "PASS (pipeline mode)"
+else
+    echo "FAIL (pipeline mode: '$output')"
+fi
+
+# UTF-8 aware strategies: multibyte letters change case, 'ß' expands to "SS"
+output=$(printf 'straße ÀÉÎ élan ΑΒΓ кот' | ./textformatter --mode=utf8-upper)
+if [ "$output" == 'STRASSE ÀÉÎ ÉLAN ΑΒΓ КОТ' ]; then
+    echo "PASS (utf8 upper case)"
+else
+    echo "FAIL (utf8 upper case: '$output')"
+fi
+
+output=$(printf 'STRASSE ÀÉÎ ÉLAN ΑΒΓ КОТ' | ./textformatter --mode=utf8-lower)
+if [ "$output" == 'strasse àéî élan αβγ кот' ]; then
+    echo "PASS (utf8 lower case)"
+else
+    echo "FAIL (utf8 lower case: '$output')"
+fi
+
+output=$(printf 'élan VITAL ßeta кОТ' | ./textformatter --mode=utf8-title)
+if [ "$output" == 'Élan Vital Sseta Кот' ]; then
+    echo "PASS (utf8 title case)"
+else
+    echo "FAIL (utf8 title case: '$output')"
+fi
+
+# Rule-based title case: extra separators, stop words kept lowercase except at the start of a line
+output=$(printf 'the lord OF the rings\nstate-of-the-art read/write_mode don'"'"'t\n' | ./textformatter --mode=title-rules)
+if [ "$output" == $'The Lord of the Rings\nState-of-the-Art Read/Write_Mode Don\'t' ]; then
+    echo "PASS (rule-based title case)"
+else
+    echo "FAIL (rule-based title case: '$output')"
+fi
+
+# Strategies loaded from a plugin are named in --mode like the built-in ones, pipelines included
+output=$(printf 'hELLO, u$3r@bC!' | ./textformatter --plugin=./swapcase.so --mode=swapcase)
+if [ "$output" == 'Hello, U$3R@Bc!' ]; then
+    echo "PASS (plugin strategy)"
+else
+    echo "FAIL (plugin strategy: '$output')"
+fi
+
+output=$(printf 'tHiS iS a TeSt' | ./textformatter --plugin=./swapcase.so --mode=title,swapcase)
+if [ "$output" == 'tHIS iS a tEST' ]; then
+    echo "PASS (plugin strategy in a pipeline)"
+else
+    echo "FAIL (plugin strategy in a pipeline: '$output')"
+fi
+
+if ./textformatter --plugin=./does-not-exist.so --mode=upper < /dev/null 2> /dev/null; then
+    echo "FAIL (missing plugin accepted)"
+else
+    echo "PASS (missing plugin rejected)"
+fi
+
+if ./textformatter --mode=bogus < /dev/null 2> /dev/null; then
+    echo "FAIL (unknown mode accepted)"
+else
+    echo "PASS (unknown mode rejected)"
+fi
+
+# Bulk directory mode: every file of a small tree, formatted through io_uring (when the kernel
+# offers it) and through the thread-pool fallback, must match streaming mode file by file
+bulk_dir=$(mktemp -d)
+mkdir -p "$bulk_dir/in/nested"
+for i in $(seq 40); do
+    head -c $((i * 997)) /dev/urandom | base64 > "$bulk_dir/in/file$i.txt"
+done
+head -c 400000 /dev/urandom | base64 -w0 > "$bulk_dir/in/nested/large.txt"
+: > "$bulk_dir/in/nested/empty.txt"
+for io in auto pool; do
+    for mode in title utf8-upper; do
+        ./textformatter --mode=$mode --dir "$bulk_dir/in" --out "$bulk_dir/out" --io=$io
+        mismatches=0
+        for file in $(cd "$bulk_dir/in" && find . -type f); do
+            if [ "$(./textformatter --mode=$mode < "$bulk_dir/in/$file" | cksum)" != "$(cksum < "$bulk_dir/out/$file")" ]; then
+                mismatches=$((mismatches + 1))
+            fi
+        done
+        if [ "$mismatches" -eq 0 ]; then
+            echo "PASS (bulk mode $mode, --io=$io)"
+        else
+            echo "FAIL (bulk mode $mode, --io=$io: $mismatches files differ)"
+        fi
+        rm -rf "$bulk_dir/out"
+    done
+done
+rm -rf "$bulk_dir"
+
+# Server mode: several lines pipelined on one Unix-socket connection, each line one request
+socket_dir=$(mktemp -d)
+# Test-only plugin whose strategy throws while formatting any body containing "boom"
+cat > "$socket_dir/throwing.cpp" <<'PLUGIN'
+#include "TextFormatter.h"
+class ThrowingFormatter final : public ITextFormatter {
+public:
+    void formatSpan(std::span<char> text) override {
+        if (std::string_view(text.data(), text.size()).find("boom") != std::string_view::npos)
+            throw std::runtime_error("boom");
+    }
+};
+extern "C" bool textformatter_register(FormatterRegistry& registry, unsigned abiVersion) {
+    if (abiVersion != FormatterRegistry::pluginAbiVersion)
+        return false;
+    registry.add<ThrowingFormatter>("throwing");
+    return true;
+}
+PLUGIN
+g++ -std=c++20 -O2 -fPIC -shared -Isrc "$socket_dir/throwing.cpp" -o "$socket_dir/throwing.so"
+./textformatter --serve=unix:"$socket_dir/tf.sock" --plugin=./swapcase.so --plugin="$socket_dir/throwing.so" &
+server_pid=$!
+for attempt in $(seq 50); do [ -S "$socket_dir/tf.sock" ] && break; sleep 0.1; done
+output=$(printf 'tHiS iS\n\na TeSt\n' | ./textformatter --connect=unix:"$socket_dir/tf.sock" --mode=title)
+if [ "$output" == $'This Is\n\nA Test' ]; then
+    echo "PASS (server pipelined requests)"
+else
+    echo "FAIL (server pipelined requests: '$output')"
+fi
+
+output=$(printf 'straße\n' | ./textformatter --connect=unix:"$socket_dir/tf.sock" --mode=utf8-upper,swapcase)
+if [ "$output" == 'strasse' ]; then
+    echo "PASS (server per-request pipeline with plugin strategy)"
+else
+    echo "FAIL (server per-request pipeline with plugin strategy: '$output')"
+fi
+
+# A strategy throwing mid-format answers that request with an error frame only; the responses
+# pipelined behind it must still arrive intact and in order (a desynchronized client would
+# wait forever, hence the timeout)
+output=$(printf 'first\nboom %02000d\nlast\n' 0 | timeout 20 ./textformatter --connect=unix:"$socket_dir/tf.sock" --mode=throwing 2> "$socket_dir/err")
+if [ "$output" == $'first\nlast' ] && grep -q "server: boom" "$socket_dir/err"; then
+    echo "PASS (server error frame for a throwing strategy)"
+else
+    echo "FAIL (server error frame for a throwing strategy: '$output')"
+fi
+
+if printf 'x\n' | ./textformatter --connect=unix:"$socket_dir/tf.sock" --mode=bogus > /dev/null 2>&1; then
+    echo "FAIL (server accepted unknown strategy)"
+else
+    echo "PASS (server rejected unknown strategy)"
+fi
+kill "$server_pid"
+wait "$server_pid"
+if [ ! -e "$socket_dir/tf.sock" ]; then
+    echo "PASS (server shut down and removed its socket)"
+else
+    echo "FAIL (server left its socket behind)"
+fi
+rm -rf "$socket_dir"
+
+# A single 3 MB line spans several 1 MB read blocks; the streamed result must match the
+# interactive result, which formats the whole line in one call
+input_file=$(mktemp)
+head -c 2300000 /dev/urandom | base64 -w0 | tr '+/0123' '  \t   ' > "$input_file"
+for mode in upper lower title; do
+    case $mode in upper) choice=1 ;; lower) choice=2 ;; title) choice=3 ;; esac
+    streamed=$( { ./textformatter --mode=$mode < "$input_file"; echo; } | cksum)
+    interactive=$( { cat "$input_file"; printf "\n%s\n" "$choice"; } | ./textformatter --interactive | tail -n 1 | cksum)
+    if [ "$streamed" == "$interactive" ]; then
+        echo "PASS (block-spanning $mode)"
+    else
+        echo "FAIL (block-spanning $mode)"
+    fi
+
+    # File mode (memory-mapped) must agree with streaming mode, both to a new file and in place
+    output_file=$(mktemp)
+    ./textformatter --mode=$mode --input="$input_file" --output="$output_file"
+    cp "$input_file" "$output_file.inplace"
+    ./textformatter --mode=$mode --input="$output_file.inplace" --output="$output_file.inplace"
+    streamed=$(./textformatter --mode=$mode < "$input_file" | cksum)
+    if [ "$(cksum < "$output_file")" == "$streamed" ] && [ "$(cksum < "$output_file.inplace")" == "$streamed" ]; then
+        echo "PASS (file mode $mode)"
+    else
+        echo "FAIL (file mode $mode)"
+    fi
+    # Topology-aware scheduling (pinned workers, node-local L2-sized chunks) must not change a byte
+    ./textformatter --mode=$mode --topology --input="$input_file" --output="$output_file" 2> /dev/null
+    if [ "$(cksum < "$output_file")" == "$streamed" ]; then
+        echo "PASS (topology-aware file mode $mode)"
+    else
+        echo "FAIL (topology-aware file mode $mode)"
+    fi
+    # An explicit pool size splits the file differently and must not change a byte either
+    ./textformatter --mode=$mode --threads=3 --input="$input_file" --output="$output_file"
+    if [ "$(cksum < "$output_file")" == "$streamed" ]; then
+        echo "PASS (3-thread file mode $mode)"
+    else
+        echo "FAIL (3-thread file mode $mode)"
+    fi
+    # GPU offload from the first byte (the device kernels in a CUDA build, the CPU fallback otherwise)
+    ./textformatter --mode=$mode --gpu-threshold=1 --input="$input_file" --output="$output_file"
+    if [ "$(cksum < "$output_file")" == "$streamed" ]; then
+        echo "PASS (gpu-offload file mode $mode)"
+    else
+        echo "FAIL (gpu-offload file mode $mode)"
+    fi
+    rm -f "$output_file" "$output_file.inplace"
+done
+rm -f "$input_file"
+echo "================================"